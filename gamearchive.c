@@ -0,0 +1,1197 @@
+// gamearchive.c — indexed archive of finished games (see gamearchive.h)
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gamearchive.h"
+
+#define SEGMENT_MAGIC 0x52414752u       // "RGAR"
+#define SEGMENT_VERSION 1u
+#define SEGMENT_PREFIX "seg-"
+#define SEGMENT_SUFFIX ".rga"
+#define TEMP_SUFFIX ".tmp"
+#define RECORD_ID 8                     // a record is a u64 id, then a gamelog entry
+#define SPARSE_SIZE 24                  // u64 id, u64 time, u32 record offset, u32 unused
+#define NAME_SIZE 16                    // u32 string offset, u32 length, u32 first posting,
+                                        // u32 postings
+#define POSTING_SIZE 4                  // u32 record offset
+#define REFS_INITIAL 1024               // name references segment_write() starts with
+#define BITS_PER_BYTE 8
+#define NSEC_PER_MSEC 1000000L
+#define NSEC_PER_SEC 1000000000L
+
+// Segment header: field offsets (integers little-endian)
+#define H_MAGIC 0
+#define H_VERSION 4
+#define H_GAMES 8
+#define H_SPARSE 12                     // sparse-index entries
+#define H_NAMES 16                      // distinct player names
+#define H_POSTINGS 20
+#define H_FIRST_ID 24
+#define H_LAST_ID 32
+#define H_FIRST_TIME 40
+#define H_LAST_TIME 48
+#define H_SPARSE_OFF 56                 // records run from SEGMENT_HEADER to here
+#define H_NAMES_OFF 60
+#define H_POSTINGS_OFF 64
+#define H_STRINGS_OFF 68
+#define H_SIZE 72
+#define SEGMENT_HEADER 80
+
+typedef struct {
+    unsigned refs;                      // views holding it (archive mutex)
+    char *path;
+    const uint8_t *map;
+    size_t size;
+    uint32_t games;
+    uint32_t sparseCount;
+    uint32_t nameCount;
+    uint64_t firstId;
+    uint64_t lastId;
+    uint64_t firstTime;
+    uint64_t lastTime;
+    uint32_t sparseOff;
+    uint32_t namesOff;
+    uint32_t postingsOff;
+    uint32_t stringsOff;
+} Segment;
+
+struct GameArchiveView {
+    GameArchive *archive;
+    unsigned refs;                      // archive mutex
+    unsigned count;
+    Segment *segs[];                    // by id
+};
+
+struct GameArchive {
+    char *dir;
+    pthread_mutex_t mutex;
+    pthread_cond_t work;                // a full batch is waiting
+    GameArchiveView *current;           // holds one reference
+    uint8_t *pending;                   // records not in a segment yet
+    size_t pendingLen;
+    size_t pendingCap;
+    unsigned pendingGames;
+    unsigned flushingGames;             // taken by a flush still being written
+    uint64_t dropped;                   // refused by gamearchive_add()
+    uint64_t nextId;
+    uint64_t lastTime;                  // finish times are clamped to this
+};
+
+// Records to write as a segment: a flushed batch, or merged segments
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} Chunk;
+
+// A player name occurrence while a segment's inverted index is built
+typedef struct {
+    const char *text;
+    unsigned len;
+    uint32_t offset;                    // of the record
+} NameRef;
+
+static void put_le(uint8_t *out, uint64_t value, unsigned bytes);
+static uint64_t get_le(const uint8_t *in, unsigned bytes);
+static size_t record_parse(const Segment *seg, uint32_t offset, GameArchiveHit *hit);
+static size_t record_parse_buf(const uint8_t *buf, size_t len, GameArchiveHit *hit);
+static int compare_names(const char *a, unsigned aLen, const char *b, unsigned bLen);
+static int compare_name_refs(const void *a, const void *b);
+static bool write_all(int fd, const void *buf, size_t len);
+static Segment *segment_load(const char *path);
+static void segment_free(Segment *seg, bool unlinkFile);
+static Segment *segment_write(GameArchive *archive, const Chunk *chunks, unsigned count);
+static GameArchiveView *view_create(GameArchive *archive, Segment *const *segs,
+                                    unsigned count);
+static void view_put(GameArchiveView *view);
+static int compare_segments(const void *a, const void *b);
+static uint32_t sparse_start(const Segment *seg, bool byTime, uint64_t key);
+static bool name_find(const Segment *seg, const char *name, unsigned len,
+                      uint32_t *first, uint32_t *count);
+static uint32_t posting_offset(const Segment *seg, uint32_t index);
+
+/**
+ * put_le / get_le
+ * ---------------
+ * Little-endian integers of `bytes` bytes in segment files.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void put_le(uint8_t *out, uint64_t value, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; ++i) {
+        out[i] = (uint8_t)(value >> (BITS_PER_BYTE * i));
+    }
+}
+
+static uint64_t get_le(const uint8_t *in, unsigned bytes) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < bytes; ++i) {
+        value |= (uint64_t)in[i] << (BITS_PER_BYTE * i);
+    }
+    return value;
+}
+
+/**
+ * record_parse / record_parse_buf
+ * -------------------------------
+ * Parses the record (id and gamelog entry) at a segment offset, or at the
+ * start of a buffer, in place.
+ *
+ * Returns:
+ *   The record's size, or 0 if it is out of range or malformed.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static size_t record_parse(const Segment *seg, uint32_t offset, GameArchiveHit *hit) {
+    if (offset < SEGMENT_HEADER || offset >= seg->sparseOff) {
+        return 0;
+    }
+    return record_parse_buf(seg->map + offset, seg->sparseOff - offset, hit);
+}
+
+static size_t record_parse_buf(const uint8_t *buf, size_t len, GameArchiveHit *hit) {
+    if (len < RECORD_ID) {
+        return 0;
+    }
+    hit->id = get_le(buf, RECORD_ID);
+    size_t used = gamelog_entry_parse(buf + RECORD_ID, len - RECORD_ID, &hit->entry);
+    return used ? RECORD_ID + used : 0;
+}
+
+/**
+ * compare_names / compare_name_refs
+ * ---------------------------------
+ * Byte order of names (a prefix sorts first); name references tie-break
+ * on record offset so each name's postings come out in id order.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int compare_names(const char *a, unsigned aLen, const char *b, unsigned bLen) {
+    int c = memcmp(a, b, aLen < bLen ? aLen : bLen);
+    if (c != 0) {
+        return c;
+    }
+    return aLen < bLen ? -1 : aLen > bLen;
+}
+
+static int compare_name_refs(const void *a, const void *b) {
+    const NameRef *x = a;
+    const NameRef *y = b;
+    int c = compare_names(x->text, x->len, y->text, y->len);
+    if (c != 0) {
+        return c;
+    }
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+/**
+ * write_all
+ * ---------
+ * Writes a whole buffer, retrying short writes and EINTR.
+ *
+ * Returns:
+ *   true if everything was written.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * segment_load
+ * ------------
+ * Maps a segment file read-only and checks its header: every section
+ * must lie inside the file, in order. Records and index entries are
+ * bounds-checked again when they are read.
+ *
+ * Parameters:
+ *   path - the segment file.
+ *
+ * Returns:
+ *   The segment (one reference, for the caller), or NULL.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static Segment *segment_load(const char *path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    Segment *seg = calloc(1, sizeof *seg);
+    void *map = MAP_FAILED;
+    if (seg && fstat(fd, &st) == 0 && st.st_size >= SEGMENT_HEADER &&
+            (uint64_t)st.st_size <= UINT32_MAX) {
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        free(seg);
+        return NULL;
+    }
+    const uint8_t *h = map;
+    seg->map = h;
+    seg->size = (size_t)st.st_size;
+    seg->games = (uint32_t)get_le(h + H_GAMES, 4);
+    seg->sparseCount = (uint32_t)get_le(h + H_SPARSE, 4);
+    seg->nameCount = (uint32_t)get_le(h + H_NAMES, 4);
+    uint64_t postings = get_le(h + H_POSTINGS, 4);
+    seg->firstId = get_le(h + H_FIRST_ID, 8);
+    seg->lastId = get_le(h + H_LAST_ID, 8);
+    seg->firstTime = get_le(h + H_FIRST_TIME, 8);
+    seg->lastTime = get_le(h + H_LAST_TIME, 8);
+    seg->sparseOff = (uint32_t)get_le(h + H_SPARSE_OFF, 4);
+    seg->namesOff = (uint32_t)get_le(h + H_NAMES_OFF, 4);
+    seg->postingsOff = (uint32_t)get_le(h + H_POSTINGS_OFF, 4);
+    seg->stringsOff = (uint32_t)get_le(h + H_STRINGS_OFF, 4);
+    bool ok = get_le(h + H_MAGIC, 4) == SEGMENT_MAGIC &&
+              get_le(h + H_VERSION, 4) == SEGMENT_VERSION &&
+              get_le(h + H_SIZE, 4) == seg->size && seg->games > 0 &&
+              seg->firstId <= seg->lastId && seg->sparseOff > SEGMENT_HEADER &&
+              seg->sparseCount == (seg->games + GAMEARCHIVE_INDEX_STRIDE - 1) /
+                                  GAMEARCHIVE_INDEX_STRIDE &&
+              seg->namesOff == seg->sparseOff + (uint64_t)seg->sparseCount * SPARSE_SIZE &&
+              seg->postingsOff == seg->namesOff + (uint64_t)seg->nameCount * NAME_SIZE &&
+              seg->stringsOff == seg->postingsOff + postings * POSTING_SIZE &&
+              seg->stringsOff <= seg->size;
+    seg->path = ok ? strdup(path) : NULL;
+    if (!seg->path) {
+        segment_free(seg, false);
+        return NULL;
+    }
+    seg->refs = 1;
+    return seg;
+}
+
+/**
+ * segment_free
+ * ------------
+ * Unmaps a segment nobody holds any more, removing its file if a merge
+ * has replaced it.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void segment_free(Segment *seg, bool unlinkFile) {
+    if (unlinkFile && seg->path) {
+        unlink(seg->path);
+    }
+    munmap((void *)seg->map, seg->size);
+    free(seg->path);
+    free(seg);
+}
+
+/**
+ * segment_write
+ * -------------
+ * Writes records (in id order, so in time order too) as a new segment:
+ * header, the records as given, then the sparse index, the name table,
+ * postings and name strings. The file is written under a temporary name,
+ * synced and renamed, so a crash leaves either the whole segment or none.
+ *
+ * Parameters:
+ *   archive - the archive (its directory).
+ *   chunks  - the records, possibly spread over several buffers.
+ *   count   - number of chunks.
+ *
+ * Returns:
+ *   The new segment, mapped (one reference), or NULL on a malformed
+ *   record, an oversized segment or an I/O error.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static Segment *segment_write(GameArchive *archive, const Chunk *chunks, unsigned count) {
+    size_t recordsLen = 0;
+    for (unsigned c = 0; c < count; ++c) {
+        recordsLen += chunks[c].len;
+    }
+    // Every record holds a gamelog entry, so at most this many games
+    size_t maxGames = recordsLen / (RECORD_ID + GAMELOG_ENTRY_HEADER) + 1;
+    if (recordsLen == 0 || SEGMENT_HEADER + recordsLen > GAMEARCHIVE_SEGMENT_MAX) {
+        return NULL;
+    }
+    uint8_t *sparse = malloc((maxGames / GAMEARCHIVE_INDEX_STRIDE + 1) * SPARSE_SIZE);
+    NameRef *refs = NULL;
+    size_t refCap = 0;
+    uint8_t *names = NULL;
+    uint8_t *postings = NULL;
+    char *strings = NULL;
+    Segment *seg = NULL;
+    int fd = -1;
+    char path[PATH_MAX - sizeof TEMP_SUFFIX];
+    char temp[PATH_MAX];
+    if (!sparse) {
+        goto done;
+    }
+
+    // Walk the records: sparse index entries and every player name
+    uint32_t games = 0;
+    size_t refCount = 0;
+    uint64_t firstId = 0, lastId = 0, firstTime = 0, lastTime = 0;
+    uint32_t offset = SEGMENT_HEADER;
+    for (unsigned c = 0; c < count; ++c) {
+        for (size_t pos = 0; pos < chunks[c].len;) {
+            GameArchiveHit hit;
+            size_t used = record_parse_buf(chunks[c].data + pos, chunks[c].len - pos, &hit);
+            if (used == 0 || (games > 0 && hit.id <= lastId)) {
+                goto done;
+            }
+            if (games % GAMEARCHIVE_INDEX_STRIDE == 0) {
+                uint8_t *sp = sparse + games / GAMEARCHIVE_INDEX_STRIDE * SPARSE_SIZE;
+                memset(sp, 0, SPARSE_SIZE);
+                put_le(sp, hit.id, 8);
+                put_le(sp + 8, hit.entry.finishedAt, 8);
+                put_le(sp + 16, offset, 4);
+            }
+            if (games++ == 0) {
+                firstId = hit.id;
+                firstTime = hit.entry.finishedAt;
+            }
+            lastId = hit.id;
+            lastTime = hit.entry.finishedAt;
+            if (refCount + GAMELOG_SEATS > refCap) {
+                refCap = refCap ? 2 * refCap : REFS_INITIAL;
+                NameRef *grown = realloc(refs, refCap * sizeof *refs);
+                if (!grown) {
+                    goto done;
+                }
+                refs = grown;
+            }
+            for (int s = 0; s < GAMELOG_SEATS; ++s) {
+                if (hit.entry.players[s].len > 0) {
+                    refs[refCount++] = (NameRef){ hit.entry.players[s].text,
+                                                  hit.entry.players[s].len, offset };
+                }
+            }
+            pos += used;
+            offset += (uint32_t)used;
+        }
+    }
+
+    // Inverted index: names sorted and stored once, postings by name. The
+    // names are copied out of the records, so they never total more bytes.
+    if (refCount > 1) {
+        qsort(refs, refCount, sizeof *refs, compare_name_refs);
+    }
+    names = malloc(refCount * NAME_SIZE + 1);
+    postings = malloc(refCount * POSTING_SIZE + 1);
+    strings = malloc(recordsLen);
+    if (!names || !postings || !strings) {
+        goto done;
+    }
+    uint32_t nameCount = 0;
+    size_t postingCount = 0;
+    size_t stringsLen = 0;
+    for (size_t i = 0; i < refCount; ++i) {
+        if (i == 0 || compare_names(refs[i].text, refs[i].len,
+                                    refs[i - 1].text, refs[i - 1].len) != 0) {
+            uint8_t *n = names + (size_t)nameCount++ * NAME_SIZE;
+            put_le(n, stringsLen, 4);
+            put_le(n + 4, refs[i].len, 4);
+            put_le(n + 8, postingCount, 4);
+            put_le(n + 12, 0, 4);
+            memcpy(strings + stringsLen, refs[i].text, refs[i].len);
+            stringsLen += refs[i].len;
+        } else if (refs[i].offset == refs[i - 1].offset) {
+            continue;                   // same player in two seats
+        }
+        uint8_t *n = names + (size_t)(nameCount - 1) * NAME_SIZE;
+        put_le(n + 12, get_le(n + 12, 4) + 1, 4);
+        put_le(postings + postingCount++ * POSTING_SIZE, refs[i].offset, 4);
+    }
+
+    uint32_t sparseCount = (games + GAMEARCHIVE_INDEX_STRIDE - 1) / GAMEARCHIVE_INDEX_STRIDE;
+    uint64_t sparseOff = SEGMENT_HEADER + recordsLen;
+    uint64_t namesOff = sparseOff + (uint64_t)sparseCount * SPARSE_SIZE;
+    uint64_t postingsOff = namesOff + (uint64_t)nameCount * NAME_SIZE;
+    uint64_t stringsOff = postingsOff + postingCount * POSTING_SIZE;
+    uint64_t size = stringsOff + stringsLen;
+    if (size > UINT32_MAX) {
+        goto done;
+    }
+    uint8_t header[SEGMENT_HEADER] = {0};
+    put_le(header + H_MAGIC, SEGMENT_MAGIC, 4);
+    put_le(header + H_VERSION, SEGMENT_VERSION, 4);
+    put_le(header + H_GAMES, games, 4);
+    put_le(header + H_SPARSE, sparseCount, 4);
+    put_le(header + H_NAMES, nameCount, 4);
+    put_le(header + H_POSTINGS, postingCount, 4);
+    put_le(header + H_FIRST_ID, firstId, 8);
+    put_le(header + H_LAST_ID, lastId, 8);
+    put_le(header + H_FIRST_TIME, firstTime, 8);
+    put_le(header + H_LAST_TIME, lastTime, 8);
+    put_le(header + H_SPARSE_OFF, sparseOff, 4);
+    put_le(header + H_NAMES_OFF, namesOff, 4);
+    put_le(header + H_POSTINGS_OFF, postingsOff, 4);
+    put_le(header + H_STRINGS_OFF, stringsOff, 4);
+    put_le(header + H_SIZE, size, 4);
+
+    snprintf(path, sizeof path, "%s/" SEGMENT_PREFIX "%016" PRIx64 "-%016" PRIx64
+             SEGMENT_SUFFIX, archive->dir, firstId, lastId);
+    snprintf(temp, sizeof temp, "%s" TEMP_SUFFIX, path);
+    fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0 && write_all(fd, header, sizeof header);
+    for (unsigned c = 0; ok && c < count; ++c) {
+        ok = write_all(fd, chunks[c].data, chunks[c].len);
+    }
+    ok = ok && write_all(fd, sparse, (size_t)sparseCount * SPARSE_SIZE) &&
+         write_all(fd, names, (size_t)nameCount * NAME_SIZE) &&
+         write_all(fd, postings, postingCount * POSTING_SIZE) &&
+         write_all(fd, strings, stringsLen) && fsync(fd) == 0 && rename(temp, path) == 0;
+    if (!ok) {
+        if (fd >= 0) {
+            unlink(temp);
+        }
+        goto done;
+    }
+    // The rename must be durable before a merge removes the segments it replaces
+    int dirFd = open(archive->dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    seg = segment_load(path);
+done:
+    if (fd >= 0) {
+        close(fd);
+    }
+    free(sparse);
+    free(refs);
+    free(names);
+    free(postings);
+    free(strings);
+    return seg;
+}
+
+/**
+ * view_create / view_put
+ * ----------------------
+ * A view is an immutable list of segments, shared by the archive (while
+ * current) and by lookups. view_create() takes a reference on each
+ * segment; the last view_put() drops them, unmapping segments no view
+ * holds any more (outside the mutex, as unmapping a large one is slow).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static GameArchiveView *view_create(GameArchive *archive, Segment *const *segs,
+                                    unsigned count) {
+    GameArchiveView *view = malloc(sizeof *view + count * sizeof *segs);
+    if (!view) {
+        return NULL;
+    }
+    view->archive = archive;
+    view->refs = 1;
+    view->count = count;
+    for (unsigned i = 0; i < count; ++i) {
+        view->segs[i] = segs[i];
+        segs[i]->refs++;
+    }
+    return view;
+}
+
+static void view_put(GameArchiveView *view) {
+    GameArchive *archive = view->archive;
+    unsigned dead = 0;
+    pthread_mutex_lock(&archive->mutex);
+    if (--view->refs > 0) {
+        pthread_mutex_unlock(&archive->mutex);
+        return;
+    }
+    for (unsigned i = 0; i < view->count; ++i) {
+        if (--view->segs[i]->refs == 0) {
+            view->segs[dead++] = view->segs[i];
+        }
+    }
+    pthread_mutex_unlock(&archive->mutex);
+    for (unsigned i = 0; i < dead; ++i) {
+        segment_free(view->segs[i], false);
+    }
+    free(view);
+}
+
+/**
+ * compare_segments
+ * ----------------
+ * qsort order for segments found on disk: by first id, the widest first,
+ * so a merged segment comes before the ones it replaced.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int compare_segments(const void *a, const void *b) {
+    const Segment *x = *(Segment *const *)a;
+    const Segment *y = *(Segment *const *)b;
+    if (x->firstId != y->firstId) {
+        return x->firstId < y->firstId ? -1 : 1;
+    }
+    return x->lastId > y->lastId ? -1 : x->lastId < y->lastId;
+}
+
+/**
+ * gamearchive_open
+ * ----------------
+ * Opens (creating it if needed) an archive directory. Leftover temporary
+ * files are removed. Segments a finished merge covered, still there
+ * because of a crash before they were removed, are removed now; new ids
+ * carry on after the highest archived one.
+ *
+ * Parameters:
+ *   dir - the archive directory.
+ *
+ * Returns:
+ *   The archive, or NULL if the directory cannot be used.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+GameArchive *gamearchive_open(const char *dir) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return NULL;
+    }
+    DIR *d = opendir(dir);
+    GameArchive *archive = d ? calloc(1, sizeof *archive) : NULL;
+    if (!archive || !(archive->dir = strdup(dir))) {
+        free(archive);
+        if (d) {
+            closedir(d);
+        }
+        return NULL;
+    }
+    Segment **found = NULL;
+    unsigned count = 0;
+    unsigned cap = 0;
+    struct dirent *ent;
+    char path[PATH_MAX];
+    while ((ent = readdir(d)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        snprintf(path, sizeof path, "%s/%s", dir, ent->d_name);
+        if (len > strlen(TEMP_SUFFIX) &&
+                strcmp(ent->d_name + len - strlen(TEMP_SUFFIX), TEMP_SUFFIX) == 0) {
+            unlink(path);
+            continue;
+        }
+        if (strncmp(ent->d_name, SEGMENT_PREFIX, strlen(SEGMENT_PREFIX)) != 0 ||
+                len <= strlen(SEGMENT_SUFFIX) ||
+                strcmp(ent->d_name + len - strlen(SEGMENT_SUFFIX), SEGMENT_SUFFIX) != 0) {
+            continue;
+        }
+        Segment *seg = segment_load(path);
+        if (!seg) {
+            continue;
+        }
+        if (count == cap) {
+            cap = cap ? 2 * cap : 16;
+            Segment **grown = realloc(found, cap * sizeof *found);
+            if (!grown) {
+                segment_free(seg, false);
+                break;
+            }
+            found = grown;
+        }
+        found[count++] = seg;
+    }
+    closedir(d);
+    if (count > 1) {
+        qsort(found, count, sizeof *found, compare_segments);
+    }
+    unsigned kept = 0;
+    uint64_t lastId = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        Segment *seg = found[i];
+        if (kept == 0 || seg->firstId > lastId) {
+            found[kept++] = seg;
+            lastId = seg->lastId;
+            archive->lastTime = seg->lastTime > archive->lastTime ? seg->lastTime
+                                                                  : archive->lastTime;
+        } else {
+            // Covered by a merge; one only partly covered is left on disk
+            segment_free(seg, seg->lastId <= lastId);
+        }
+    }
+    archive->nextId = lastId + 1;
+    pthread_mutex_init(&archive->mutex, NULL);
+    pthread_cond_init(&archive->work, NULL);
+    archive->current = view_create(archive, found, kept);
+    for (unsigned i = 0; i < kept; ++i) {
+        if (--found[i]->refs == 0) {    // the view's reference replaces the load's
+            segment_free(found[i], false);
+        }
+    }
+    free(found);
+    if (!archive->current) {
+        free(archive->dir);
+        free(archive);
+        return NULL;
+    }
+    return archive;
+}
+
+/**
+ * gamearchive_add
+ * ---------------
+ * Queues a finished game for the next segment and gives it an id. Its
+ * finish time is now, or the last game's if the clock went back, so ids
+ * and times stay in the same order. The game is in memory only until
+ * gamearchive_flush() writes that segment.
+ *
+ * Parameters:
+ *   archive    - the archive.
+ *   log        - the game's deck and plays.
+ *   terminated - it ended early.
+ *   gameName   - its name.
+ *   players    - player names by seat.
+ *
+ * Returns:
+ *   The game's id, or 0 if it was not archived (never dealt, out of
+ *   memory, or GAMEARCHIVE_PENDING_MAX games already waiting for a flush
+ *   that keeps failing; those are counted in GameArchiveStats.dropped).
+ *
+ * Concurrency:
+ *   Any thread. The entry is built under the archive mutex, which only
+ *   costs the encoding of one game.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+uint64_t gamearchive_add(GameArchive *archive, const GameLog *log, bool terminated,
+                         const char *gameName, char *const players[GAMELOG_SEATS]) {
+    if (!log->dealt) {
+        return 0;
+    }
+    uint64_t now = (uint64_t)time(NULL);
+    uint64_t id = 0;
+    pthread_mutex_lock(&archive->mutex);
+    if (archive->pendingGames + archive->flushingGames >= GAMEARCHIVE_PENDING_MAX) {
+        archive->dropped++;
+        pthread_mutex_unlock(&archive->mutex);
+        return 0;
+    }
+    size_t needed = archive->pendingLen + RECORD_ID + GAMELOG_ENTRY_MAX;
+    if (needed > archive->pendingCap) {
+        size_t cap = archive->pendingCap ? 2 * archive->pendingCap : 64 * GAMELOG_ENTRY_MAX;
+        cap = cap < needed ? needed : cap;
+        uint8_t *grown = realloc(archive->pending, cap);
+        if (!grown) {
+            pthread_mutex_unlock(&archive->mutex);
+            return 0;
+        }
+        archive->pending = grown;
+        archive->pendingCap = cap;
+    }
+    if (now > archive->lastTime) {
+        archive->lastTime = now;
+    }
+    uint8_t *rec = archive->pending + archive->pendingLen;
+    size_t used = gamelog_entry_build(log, archive->lastTime, terminated, gameName, players,
+                                      rec + RECORD_ID);
+    if (used > 0) {
+        id = archive->nextId++;
+        put_le(rec, id, RECORD_ID);
+        archive->pendingLen += RECORD_ID + used;
+        if (++archive->pendingGames >= GAMEARCHIVE_FLUSH_GAMES) {
+            pthread_cond_signal(&archive->work);
+        }
+    }
+    pthread_mutex_unlock(&archive->mutex);
+    return id;
+}
+
+/**
+ * gamearchive_wait
+ * ----------------
+ * Waits until a full batch is queued or timeoutMs has passed, whichever
+ * comes first; the caller then flushes.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+void gamearchive_wait(GameArchive *archive, unsigned timeoutMs) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long)(timeoutMs % 1000) * NSEC_PER_MSEC;
+    if (deadline.tv_nsec >= NSEC_PER_SEC) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= NSEC_PER_SEC;
+    }
+    pthread_mutex_lock(&archive->mutex);
+    if (archive->pendingGames < GAMEARCHIVE_FLUSH_GAMES) {
+        pthread_cond_timedwait(&archive->work, &archive->mutex, &deadline);
+    }
+    pthread_mutex_unlock(&archive->mutex);
+}
+
+/**
+ * gamearchive_flush
+ * -----------------
+ * Writes the queued games as a new segment and publishes it to lookups.
+ *
+ * Parameters:
+ *   archive - the archive.
+ *
+ * Returns:
+ *   true if there was nothing to write or the segment was written; false
+ *   on an I/O error, in which case the games stay queued for next time.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+bool gamearchive_flush(GameArchive *archive) {
+    pthread_mutex_lock(&archive->mutex);
+    Chunk batch = { archive->pending, archive->pendingLen };
+    uint8_t *taken = archive->pending;
+    size_t takenCap = archive->pendingCap;
+    unsigned takenGames = archive->pendingGames;
+    if (batch.len > 0) {
+        archive->pending = NULL;
+        archive->pendingLen = 0;
+        archive->pendingCap = 0;
+        archive->pendingGames = 0;
+        archive->flushingGames = takenGames;
+    }
+    pthread_mutex_unlock(&archive->mutex);
+    if (batch.len == 0) {
+        return true;
+    }
+
+    Segment *seg = segment_write(archive, &batch, 1);
+    pthread_mutex_lock(&archive->mutex);
+    archive->flushingGames = 0;
+    if (!seg) {
+        // Requeue ahead of anything added meanwhile, keeping id order
+        if (archive->pendingLen > 0 && batch.len + archive->pendingLen > takenCap) {
+            uint8_t *grown = realloc(taken, batch.len + archive->pendingLen);
+            if (grown) {
+                taken = grown;
+                takenCap = batch.len + archive->pendingLen;
+            }
+        }
+        if (batch.len + archive->pendingLen <= takenCap) {
+            if (archive->pendingLen > 0) {
+                memcpy(taken + batch.len, archive->pending, archive->pendingLen);
+            }
+            free(archive->pending);
+            archive->pending = taken;
+            archive->pendingLen += batch.len;
+            archive->pendingCap = takenCap;
+            archive->pendingGames += takenGames;
+        } else {
+            free(taken);                // out of memory: this batch is lost
+        }
+        pthread_mutex_unlock(&archive->mutex);
+        return false;
+    }
+    GameArchiveView *old = archive->current;
+    GameArchiveView *next = malloc(sizeof *next + (old->count + 1) * sizeof *old->segs);
+    if (next) {
+        next->archive = archive;
+        next->refs = 1;
+        next->count = old->count + 1;
+        memcpy(next->segs, old->segs, old->count * sizeof *old->segs);
+        next->segs[old->count] = seg;   // takes the load's reference
+        for (unsigned i = 0; i < old->count; ++i) {
+            old->segs[i]->refs++;
+        }
+        archive->current = next;
+    }
+    pthread_mutex_unlock(&archive->mutex);
+    free(taken);
+    if (!next) {
+        // The segment is on disk and will be found at the next start
+        segment_free(seg, false);
+        return false;
+    }
+    view_put(old);
+    return true;
+}
+
+/**
+ * gamearchive_compact
+ * -------------------
+ * Merges the newest run of segments in which each older segment holds no
+ * more games than all the newer ones together, like the carries of a
+ * binary counter: every game is rewritten O(log n) times and the archive
+ * keeps O(log n) segments. Segments are id ranges in order, so a merge
+ * copies their records end to end and rebuilds the indexes. Lookups in
+ * progress keep the replaced segments mapped until they finish.
+ *
+ * Parameters:
+ *   archive - the archive.
+ *
+ * Returns:
+ *   Number of segments merged (0 if none were due), or -1 on an error.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+int gamearchive_compact(GameArchive *archive) {
+    GameArchiveView *view = gamearchive_view(archive);
+    unsigned n = view->count;
+    unsigned first = n;
+    if (n >= 2) {
+        uint64_t games = view->segs[n - 1]->games;
+        uint64_t bytes = view->segs[n - 1]->sparseOff;
+        first = n - 1;
+        while (first > 0 && view->segs[first - 1]->games <= games &&
+                bytes + view->segs[first - 1]->sparseOff <= GAMEARCHIVE_SEGMENT_MAX) {
+            first--;
+            games += view->segs[first]->games;
+            bytes += view->segs[first]->sparseOff;
+        }
+    }
+    if (first + 1 >= n) {
+        gamearchive_release(view);
+        return 0;
+    }
+    unsigned merged = n - first;
+    Chunk *chunks = malloc(merged * sizeof *chunks);
+    Segment *seg = NULL;
+    if (chunks) {
+        for (unsigned i = 0; i < merged; ++i) {
+            const Segment *s = view->segs[first + i];
+            chunks[i] = (Chunk){ s->map + SEGMENT_HEADER, s->sparseOff - SEGMENT_HEADER };
+        }
+        seg = segment_write(archive, chunks, merged);
+        free(chunks);
+    }
+    if (!seg) {
+        gamearchive_release(view);
+        return -1;
+    }
+
+    // Swap it in for the segments it covers
+    pthread_mutex_lock(&archive->mutex);
+    GameArchiveView *old = archive->current;
+    GameArchiveView *next = malloc(sizeof *next + old->count * sizeof *old->segs);
+    if (next) {
+        next->archive = archive;
+        next->refs = 1;
+        next->count = 0;
+        for (unsigned i = 0; i < old->count; ++i) {
+            Segment *s = old->segs[i];
+            if (s->lastId < seg->firstId || s->firstId > seg->lastId) {
+                next->segs[next->count++] = s;
+                s->refs++;
+            } else if (s->firstId == seg->firstId) {
+                next->segs[next->count++] = seg;
+            }
+        }
+        archive->current = next;
+    }
+    pthread_mutex_unlock(&archive->mutex);
+    if (!next) {
+        segment_free(seg, true);
+        gamearchive_release(view);
+        return -1;
+    }
+    for (unsigned i = first; i < n; ++i) {
+        unlink(view->segs[i]->path);    // still mapped by the views holding it
+    }
+    view_put(old);
+    gamearchive_release(view);
+    return (int)merged;
+}
+
+/**
+ * gamearchive_view / gamearchive_release
+ * --------------------------------------
+ * Takes and drops a reference to the current segments. Entries found
+ * through a view stay valid until it is released.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+GameArchiveView *gamearchive_view(GameArchive *archive) {
+    pthread_mutex_lock(&archive->mutex);
+    GameArchiveView *view = archive->current;
+    view->refs++;
+    pthread_mutex_unlock(&archive->mutex);
+    return view;
+}
+
+void gamearchive_release(GameArchiveView *view) {
+    view_put(view);
+}
+
+/**
+ * sparse_start
+ * ------------
+ * Binary-searches a segment's sparse index for where a scan should
+ * begin: the last indexed game whose id (or time) is below key, since
+ * the games up to the next indexed one may still match.
+ *
+ * Parameters:
+ *   seg    - the segment.
+ *   byTime - key is a time, not an id.
+ *   key    - id or time sought.
+ *
+ * Returns:
+ *   Offset of the record to start scanning from.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static uint32_t sparse_start(const Segment *seg, bool byTime, uint64_t key) {
+    const uint8_t *base = seg->map + seg->sparseOff;
+    uint32_t lo = 0;
+    uint32_t hi = seg->sparseCount;     // first entry with a value >= key
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (get_le(base + (size_t)mid * SPARSE_SIZE + (byTime ? 8 : 0), 8) < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    uint32_t entry = lo > 0 ? lo - 1 : 0;
+    return (uint32_t)get_le(base + (size_t)entry * SPARSE_SIZE + 16, 4);
+}
+
+/**
+ * name_find
+ * ---------
+ * Binary-searches a segment's name table.
+ *
+ * Parameters:
+ *   seg         - the segment.
+ *   name, len   - the player name.
+ *   first/count - receive the name's postings.
+ *
+ * Returns:
+ *   true if the player has games in the segment.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool name_find(const Segment *seg, const char *name, unsigned len,
+                      uint32_t *first, uint32_t *count) {
+    const char *strings = (const char *)seg->map + seg->stringsOff;
+    size_t stringsLen = seg->size - seg->stringsOff;
+    uint32_t lo = 0;
+    uint32_t hi = seg->nameCount;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const uint8_t *n = seg->map + seg->namesOff + (size_t)mid * NAME_SIZE;
+        uint64_t off = get_le(n, 4);
+        uint64_t nameLen = get_le(n + 4, 4);
+        if (off + nameLen > stringsLen) {
+            return false;               // damaged table
+        }
+        int c = compare_names(name, len, strings + off, (unsigned)nameLen);
+        if (c == 0) {
+            *first = (uint32_t)get_le(n + 8, 4);
+            *count = (uint32_t)get_le(n + 12, 4);
+            return true;
+        }
+        if (c < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return false;
+}
+
+/**
+ * posting_offset
+ * --------------
+ * Record offset of a posting, or 0 (never a record) if it lies outside
+ * the postings section.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static uint32_t posting_offset(const Segment *seg, uint32_t index) {
+    uint64_t at = seg->postingsOff + (uint64_t)index * POSTING_SIZE;
+    if (at + POSTING_SIZE > seg->stringsOff) {
+        return 0;
+    }
+    return (uint32_t)get_le(seg->map + at, 4);
+}
+
+/**
+ * gamearchive_find
+ * ----------------
+ * Looks up one game by id: a binary search over segments, then over the
+ * segment's sparse index, then a scan of at most
+ * GAMEARCHIVE_INDEX_STRIDE records.
+ *
+ * Parameters:
+ *   view - segments to search.
+ *   id   - the game's id.
+ *   hit  - receives the game (pointing into the view's mapping).
+ *
+ * Returns:
+ *   true if the game is archived.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+bool gamearchive_find(const GameArchiveView *view, uint64_t id, GameArchiveHit *hit) {
+    unsigned lo = 0;
+    unsigned hi = view->count;          // first segment starting after id
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        if (view->segs[mid]->firstId <= id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0 || view->segs[lo - 1]->lastId < id) {
+        return false;
+    }
+    const Segment *seg = view->segs[lo - 1];
+    uint32_t offset = sparse_start(seg, false, id);
+    for (int i = 0; i <= GAMEARCHIVE_INDEX_STRIDE; ++i) {
+        size_t used = record_parse(seg, offset, hit);
+        if (used == 0 || hit->id > id) {
+            return false;
+        }
+        if (hit->id == id) {
+            return true;
+        }
+        offset += (uint32_t)used;
+    }
+    return false;
+}
+
+/**
+ * gamearchive_by_time
+ * -------------------
+ * Visits the games that finished between from and until (inclusive, Unix
+ * seconds). Each segment in the range is entered through its sparse
+ * index.
+ *
+ * Parameters:
+ *   view        - segments to search.
+ *   from, until - the time range.
+ *   visit, arg  - called per game, in id order; false stops the lookup.
+ *
+ * Returns:
+ *   Number of games visited.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+size_t gamearchive_by_time(const GameArchiveView *view, uint64_t from, uint64_t until,
+                           GameArchiveVisit visit, void *arg) {
+    size_t visited = 0;
+    for (unsigned s = 0; s < view->count; ++s) {
+        const Segment *seg = view->segs[s];
+        if (seg->firstTime > until) {
+            break;                      // times rise with ids across segments too
+        }
+        if (seg->lastTime < from) {
+            continue;
+        }
+        GameArchiveHit hit;
+        size_t used;
+        for (uint32_t offset = sparse_start(seg, true, from);
+                (used = record_parse(seg, offset, &hit)) > 0; offset += (uint32_t)used) {
+            if (hit.entry.finishedAt > until) {
+                return visited;
+            }
+            if (hit.entry.finishedAt >= from) {
+                visited++;
+                if (!visit(&hit, arg)) {
+                    return visited;
+                }
+            }
+        }
+    }
+    return visited;
+}
+
+/**
+ * gamearchive_by_player
+ * ---------------------
+ * Visits a player's games that finished between from and until
+ * (inclusive): per segment, the name is found in the inverted index and
+ * its postings, in time order, are binary-searched for from.
+ *
+ * Parameters:
+ *   view        - segments to search.
+ *   name        - the player (as sent when joining; matched exactly).
+ *   from, until - the time range.
+ *   visit, arg  - called per game, in id order; false stops the lookup.
+ *
+ * Returns:
+ *   Number of games visited.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+size_t gamearchive_by_player(const GameArchiveView *view, const char *name, uint64_t from,
+                             uint64_t until, GameArchiveVisit visit, void *arg) {
+    size_t len = strlen(name);
+    len = len > GAMELOG_NAME_MAX ? GAMELOG_NAME_MAX : len;     // as entries store it
+    size_t visited = 0;
+    for (unsigned s = 0; s < view->count; ++s) {
+        const Segment *seg = view->segs[s];
+        uint32_t first = 0;
+        uint32_t count = 0;
+        if (seg->firstTime > until) {
+            break;
+        }
+        if (seg->lastTime < from || !name_find(seg, name, (unsigned)len, &first, &count)) {
+            continue;
+        }
+        GameArchiveHit hit;
+        uint32_t lo = 0;
+        uint32_t hi = count;            // first posting at or after from
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (record_parse(seg, posting_offset(seg, first + mid), &hit) == 0) {
+                return visited;         // damaged postings
+            }
+            if (hit.entry.finishedAt < from) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (uint32_t p = lo; p < count; ++p) {
+            if (record_parse(seg, posting_offset(seg, first + p), &hit) == 0 ||
+                    hit.entry.finishedAt > until) {
+                return visited;
+            }
+            visited++;
+            if (!visit(&hit, arg)) {
+                return visited;
+            }
+        }
+    }
+    return visited;
+}
+
+/**
+ * gamearchive_stats
+ * -----------------
+ * Current segment count, archived games and bytes, and games queued.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+void gamearchive_stats(GameArchive *archive, GameArchiveStats *stats) {
+    memset(stats, 0, sizeof *stats);
+    pthread_mutex_lock(&archive->mutex);
+    const GameArchiveView *view = archive->current;
+    stats->segments = view->count;
+    for (unsigned i = 0; i < view->count; ++i) {
+        stats->games += view->segs[i]->games;
+        stats->bytes += view->segs[i]->size;
+    }
+    stats->pending = archive->pendingGames;
+    stats->dropped = archive->dropped;
+    pthread_mutex_unlock(&archive->mutex);
+}
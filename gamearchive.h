@@ -0,0 +1,75 @@
+// gamearchive.h — indexed archive of finished games (ratsserver --archive).
+//
+// Games get ids in the order they finish and are written out in batches
+// as immutable segment files of gamelog.h entries, sorted by id. Finish
+// times are clamped so they never go backwards, so each segment is sorted
+// by time as well. Besides its entries a segment holds:
+//   - a sparse index: id, time and offset of every
+//     GAMEARCHIVE_INDEX_STRIDE-th game;
+//   - an inverted index: each player name once (sorted), with the offsets
+//     of that player's games in the segment.
+// Lookups binary-search these in read-only mappings and return entries
+// that point into the mapping. A background merge folds runs of small
+// segments into larger ones, so a lookup visits O(log n) segments.
+//
+// gamearchive_add() may be called from any thread; flush and compact
+// from a single thread. A view keeps its segments mapped after a merge
+// has replaced them, so lookups never race with compaction.
+//
+// Added games are held in memory until the next flush (ratsserver
+// flushes every second, or at GAMEARCHIVE_FLUSH_GAMES): a crash loses
+// those. While segments cannot be written, at most GAMEARCHIVE_PENDING_MAX
+// games are held; later ones are dropped and counted. Ids are only unique within one archive directory; ratsserver
+// --processes gives each worker its own directory, and so its own ids.
+
+#ifndef GAMEARCHIVE_H
+#define GAMEARCHIVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gamelog.h"
+
+#define GAMEARCHIVE_INDEX_STRIDE 32     // games per sparse-index entry
+#define GAMEARCHIVE_FLUSH_GAMES 4096    // batch size that wakes the flusher early
+#define GAMEARCHIVE_PENDING_MAX (16 * GAMEARCHIVE_FLUSH_GAMES)  // held unwritten, at most
+#define GAMEARCHIVE_SEGMENT_MAX (1u << 30)  // merges stop at this many bytes
+
+typedef struct GameArchive GameArchive;
+typedef struct GameArchiveView GameArchiveView;
+
+// One archived game: entry points into the view's mapping
+typedef struct {
+    uint64_t id;
+    GameLogEntry entry;
+} GameArchiveHit;
+
+// Called for each game a range lookup finds, in id order; returning
+// false stops the lookup
+typedef bool (*GameArchiveVisit)(const GameArchiveHit *hit, void *arg);
+
+typedef struct {
+    unsigned segments;
+    uint64_t games;
+    uint64_t bytes;
+    uint64_t pending;                   // added, not yet in a segment
+    uint64_t dropped;                   // refused: GAMEARCHIVE_PENDING_MAX were held
+} GameArchiveStats;
+
+GameArchive *gamearchive_open(const char *dir);
+uint64_t gamearchive_add(GameArchive *archive, const GameLog *log, bool terminated,
+                         const char *gameName, char *const players[GAMELOG_SEATS]);
+void gamearchive_wait(GameArchive *archive, unsigned timeoutMs);
+bool gamearchive_flush(GameArchive *archive);
+int gamearchive_compact(GameArchive *archive);
+GameArchiveView *gamearchive_view(GameArchive *archive);
+void gamearchive_release(GameArchiveView *view);
+bool gamearchive_find(const GameArchiveView *view, uint64_t id, GameArchiveHit *hit);
+size_t gamearchive_by_time(const GameArchiveView *view, uint64_t from, uint64_t until,
+                           GameArchiveVisit visit, void *arg);
+size_t gamearchive_by_player(const GameArchiveView *view, const char *name, uint64_t from,
+                             uint64_t until, GameArchiveVisit visit, void *arg);
+void gamearchive_stats(GameArchive *archive, GameArchiveStats *stats);
+
+#endif
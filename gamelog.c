@@ -0,0 +1,584 @@
+// gamelog.c — compact codec for finished games (see gamelog.h)
+
+#include <string.h>
+
+#include "gamelog.h"
+
+#define CARD_BITS 6                     // raw card id
+#define RANKS_PER_SUIT 13
+#define SUIT_MASK ((1ull << RANKS_PER_SUIT) - 1)
+#define FULL_DECK ((1ull << GAMELOG_CARDS) - 1)
+#define HEADER_PLAYS 0x3fu              // coded byte 0: number of plays
+#define HEADER_RAW 0x40u                //               six bits per card
+#define ENTRY_TERMINATED 0x01u
+#define BITS_PER_BYTE 8
+#define REFILL_LIMIT 56                 // bits_get() tops up while a byte still fits
+
+typedef struct {
+    uint8_t *out;
+    size_t used;
+    uint64_t acc;
+    unsigned bits;                      // in acc, not yet written
+} BitWriter;
+
+typedef struct {
+    const uint8_t *in;
+    size_t len;
+    size_t pos;
+    uint64_t acc;
+    unsigned bits;                      // in acc, not yet consumed
+    bool overrun;                       // read past the end
+} BitReader;
+
+// Where a game stands while it is replayed
+typedef struct {
+    uint64_t hands[GAMELOG_SEATS];      // card-id bit masks
+    int leader;                         // seat leading the current trick
+    int offset;                         // cards already played in it
+    int leadSuit;
+    int bestRank;                       // highest lead-suit rank so far
+    int bestSeat;
+} Replay;
+
+static void bits_put(BitWriter *w, uint32_t value, unsigned width);
+static void bits_flush(BitWriter *w);
+static uint32_t bits_get(BitReader *r, unsigned width);
+static void put_choice(BitWriter *w, unsigned index, unsigned choices);
+static unsigned get_choice(BitReader *r, unsigned choices);
+static unsigned floor_log2(unsigned n);
+static int select_bit(uint64_t mask, unsigned index);
+static unsigned rank_below(uint64_t mask, int card);
+static unsigned count_cards(uint64_t mask);
+static bool deal(Replay *replay, const uint8_t deck[GAMELOG_CARDS]);
+static uint64_t legal_cards(const Replay *replay);
+static void play_card(Replay *replay, int card);
+static bool plays_are_legal(const GameLog *log);
+static void put_le(uint8_t *out, uint64_t value, unsigned bytes);
+static uint64_t get_le(const uint8_t *in, unsigned bytes);
+
+/**
+ * bits_put / bits_flush
+ * ---------------------
+ * Append `width` bits of `value`, most significant first; bits_flush()
+ * pads the last byte with zeroes.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void bits_put(BitWriter *w, uint32_t value, unsigned width) {
+    w->acc = (w->acc << width) | value;
+    w->bits += width;
+    while (w->bits >= BITS_PER_BYTE) {
+        w->bits -= BITS_PER_BYTE;
+        w->out[w->used++] = (uint8_t)(w->acc >> w->bits);
+    }
+}
+
+static void bits_flush(BitWriter *w) {
+    if (w->bits > 0) {
+        w->out[w->used++] = (uint8_t)(w->acc << (BITS_PER_BYTE - w->bits));
+        w->bits = 0;
+    }
+}
+
+/**
+ * bits_get
+ * --------
+ * Reads `width` bits (at most 24), most significant first. Reading past
+ * the end yields zeroes and sets overrun.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static uint32_t bits_get(BitReader *r, unsigned width) {
+    if (r->bits < width) {
+        // Top up as far as the accumulator allows, so most calls skip this
+        while (r->bits <= REFILL_LIMIT && r->pos < r->len) {
+            r->acc = (r->acc << BITS_PER_BYTE) | r->in[r->pos++];
+            r->bits += BITS_PER_BYTE;
+        }
+        while (r->bits < width) {
+            r->acc <<= BITS_PER_BYTE;
+            r->bits += BITS_PER_BYTE;
+            r->overrun = true;
+        }
+    }
+    r->bits -= width;
+    return (uint32_t)(r->acc >> r->bits) & ((1u << width) - 1);
+}
+
+/**
+ * floor_log2
+ * ----------
+ * Returns floor(log2 n) for n >= 1.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static unsigned floor_log2(unsigned n) {
+    return (unsigned)(sizeof n * BITS_PER_BYTE - 1) - (unsigned)__builtin_clz(n);
+}
+
+/**
+ * put_choice / get_choice
+ * -----------------------
+ * Truncated binary code for one of `choices` equally likely values: with
+ * k = floor(log2 choices), the first 2^(k+1) - choices values take k
+ * bits and the rest k + 1. A single choice takes no bits.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void put_choice(BitWriter *w, unsigned index, unsigned choices) {
+    unsigned k = floor_log2(choices);
+    unsigned shortCodes = (2u << k) - choices;
+    if (index < shortCodes) {
+        bits_put(w, index, k);
+    } else {
+        bits_put(w, index + shortCodes, k + 1);
+    }
+}
+
+static unsigned get_choice(BitReader *r, unsigned choices) {
+    unsigned k = floor_log2(choices);
+    unsigned shortCodes = (2u << k) - choices;
+    unsigned value = bits_get(r, k);
+    if (value >= shortCodes) {
+        value = ((value << 1) | bits_get(r, 1)) - shortCodes;
+    }
+    return value;
+}
+
+/**
+ * select_bit / rank_below
+ * -----------------------
+ * select_bit(): the card id of the index'th set bit of mask (lowest
+ * first); used on legal sets, which hold at most 13 cards. rank_below(): how many cards in mask sort before `card`; the
+ * inverse of select_bit().
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int select_bit(uint64_t mask, unsigned index) {
+    while (index-- > 0) {
+        mask &= mask - 1;
+    }
+    return __builtin_ctzll(mask);
+}
+
+static unsigned rank_below(uint64_t mask, int card) {
+    return count_cards(mask & ((1ull << card) - 1));
+}
+
+/**
+ * count_cards
+ * -----------
+ * Population count of a card mask. Done by hand: without -mpopcnt,
+ * __builtin_popcountll() is a library call.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static unsigned count_cards(uint64_t mask) {
+    mask -= (mask >> 1) & 0x5555555555555555ull;
+    mask = (mask & 0x3333333333333333ull) + ((mask >> 2) & 0x3333333333333333ull);
+    mask = (mask + (mask >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (unsigned)((mask * 0x0101010101010101ull) >> 56);
+}
+
+/**
+ * deal
+ * ----
+ * Starts a replay: deals the deck the way build_hands_from_deck() does in
+ * the server (seat p gets cards p, p + 4, p + 8, ...), seat 0 to lead.
+ *
+ * Returns:
+ *   false if the deck is not a permutation of the 52 cards.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool deal(Replay *replay, const uint8_t deck[GAMELOG_CARDS]) {
+    memset(replay, 0, sizeof *replay);
+    uint64_t seen = 0;
+    for (int i = 0; i < GAMELOG_CARDS; ++i) {
+        if (deck[i] >= GAMELOG_CARDS || (seen & (1ull << deck[i]))) {
+            return false;
+        }
+        uint64_t bit = 1ull << deck[i];
+        seen |= bit;
+        replay->hands[i % GAMELOG_SEATS] |= bit;
+    }
+    return true;
+}
+
+/**
+ * legal_cards
+ * -----------
+ * The cards the seat to play may choose from: the lead suit if it holds
+ * any and is not leading, otherwise its whole hand.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static uint64_t legal_cards(const Replay *replay) {
+    uint64_t hand = replay->hands[(replay->leader + replay->offset) % GAMELOG_SEATS];
+    if (replay->offset > 0) {
+        uint64_t follow = hand & (SUIT_MASK << (replay->leadSuit * RANKS_PER_SUIT));
+        if (follow) {
+            return follow;
+        }
+    }
+    return hand;
+}
+
+/**
+ * play_card
+ * ---------
+ * Plays `card` for the seat to play; after the fourth card of a trick the
+ * highest card of the lead suit (winning_seat_in_trick()) leads the next.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void play_card(Replay *replay, int card) {
+    int seat = (replay->leader + replay->offset) % GAMELOG_SEATS;
+    int suit = card / RANKS_PER_SUIT;
+    int rank = card % RANKS_PER_SUIT;
+    replay->hands[seat] &= ~(1ull << card);
+    if (replay->offset == 0) {
+        replay->leadSuit = suit;
+        replay->bestRank = -1;
+    }
+    if (suit == replay->leadSuit && rank > replay->bestRank) {
+        replay->bestRank = rank;
+        replay->bestSeat = seat;
+    }
+    if (++replay->offset == GAMELOG_SEATS) {
+        replay->leader = replay->bestSeat;
+        replay->offset = 0;
+    }
+}
+
+/**
+ * plays_are_legal
+ * ---------------
+ * Replays a game to check that it can be coded compactly: a permutation
+ * deck and every play one the rules allowed.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool plays_are_legal(const GameLog *log) {
+    Replay replay;
+    if (!deal(&replay, log->deck)) {
+        return false;
+    }
+    for (unsigned i = 0; i < log->playCount; ++i) {
+        if (log->plays[i] >= GAMELOG_CARDS ||
+                !(legal_cards(&replay) & (1ull << log->plays[i]))) {
+            return false;
+        }
+        play_card(&replay, log->plays[i]);
+    }
+    return true;
+}
+
+/**
+ * gamelog_card_id / gamelog_card_text
+ * -----------------------------------
+ * Convert between a protocol card (rank and suit characters) and a card
+ * id (0..51).
+ *
+ * Returns:
+ *   gamelog_card_id(): the id, or -1 if either character is not valid.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+int gamelog_card_id(char rank, char suit) {
+    const char *r = rank ? strchr(GAMELOG_RANKS, rank) : NULL;
+    const char *s = suit ? strchr(GAMELOG_SUITS, suit) : NULL;
+    if (!r || !s) {
+        return -1;
+    }
+    return (int)(s - GAMELOG_SUITS) * RANKS_PER_SUIT + (int)(r - GAMELOG_RANKS);
+}
+
+void gamelog_card_text(int id, char *rankOut, char *suitOut) {
+    *rankOut = GAMELOG_RANKS[id % RANKS_PER_SUIT];
+    *suitOut = GAMELOG_SUITS[id / RANKS_PER_SUIT];
+}
+
+/**
+ * gamelog_set_deck
+ * ----------------
+ * Starts a log from the 104-character deck a game was dealt from.
+ *
+ * Parameters:
+ *   log     - log to (re)initialise.
+ *   deckStr - rank/suit pairs, as get_random_deck() returns them.
+ *
+ * Returns:
+ *   true if every card was valid; otherwise the log stays undealt.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+bool gamelog_set_deck(GameLog *log, const char *deckStr) {
+    memset(log, 0, sizeof *log);
+    for (int i = 0; i < GAMELOG_CARDS; ++i) {
+        int id = gamelog_card_id(deckStr[2 * i], deckStr[2 * i + 1]);
+        if (id < 0) {
+            return false;
+        }
+        log->deck[i] = (uint8_t)id;
+    }
+    log->dealt = true;
+    return true;
+}
+
+/**
+ * gamelog_add_play
+ * ----------------
+ * Records the next card played. Ignored for an undealt log, a full one,
+ * or a card that is not valid.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+void gamelog_add_play(GameLog *log, char rank, char suit) {
+    int id = gamelog_card_id(rank, suit);
+    if (log->dealt && id >= 0 && log->playCount < GAMELOG_CARDS) {
+        log->plays[log->playCount++] = (uint8_t)id;
+    }
+}
+
+/**
+ * gamelog_encode
+ * --------------
+ * Codes a game. Byte 0 holds the number of plays and the raw flag; a bit
+ * stream follows, most significant bit first:
+ *   compact: 52 deck cards, card i as its index among the 52 - i cards
+ *            not yet dealt; then each play as its index among the legal
+ *            cards (both truncated binary, lowest card id first).
+ *   raw:     every deck card, then every play, as a 6-bit card id.
+ *
+ * Parameters:
+ *   log - the game (dealt).
+ *   out - receives at most GAMELOG_MAX_CODED bytes.
+ *
+ * Returns:
+ *   Bytes written, or 0 for an undealt log.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+size_t gamelog_encode(const GameLog *log, uint8_t out[GAMELOG_MAX_CODED]) {
+    if (!log->dealt) {
+        return 0;
+    }
+    bool compact = plays_are_legal(log);
+    BitWriter w = { out, 1, 0, 0 };
+    out[0] = (uint8_t)(log->playCount | (compact ? 0u : HEADER_RAW));
+    if (!compact) {
+        for (int i = 0; i < GAMELOG_CARDS; ++i) {
+            bits_put(&w, log->deck[i], CARD_BITS);
+        }
+        for (unsigned i = 0; i < log->playCount; ++i) {
+            bits_put(&w, log->plays[i], CARD_BITS);
+        }
+        bits_flush(&w);
+        return w.used;
+    }
+    uint64_t undealt = FULL_DECK;
+    for (int i = 0; i < GAMELOG_CARDS; ++i) {
+        put_choice(&w, rank_below(undealt, log->deck[i]), (unsigned)(GAMELOG_CARDS - i));
+        undealt &= ~(1ull << log->deck[i]);
+    }
+    Replay replay;
+    deal(&replay, log->deck);
+    for (unsigned i = 0; i < log->playCount; ++i) {
+        uint64_t legal = legal_cards(&replay);
+        put_choice(&w, rank_below(legal, log->plays[i]), count_cards(legal));
+        play_card(&replay, log->plays[i]);
+    }
+    bits_flush(&w);
+    return w.used;
+}
+
+/**
+ * gamelog_decode
+ * --------------
+ * Decodes a game coded by gamelog_encode(), replaying it to learn each
+ * player's legal cards.
+ *
+ * Parameters:
+ *   in  - coded game.
+ *   len - its length in bytes.
+ *   log - receives the game.
+ *
+ * Returns:
+ *   true on success; false if the input is malformed or truncated.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+bool gamelog_decode(const uint8_t *in, size_t len, GameLog *log) {
+    if (len == 0 || (in[0] & HEADER_PLAYS) > GAMELOG_CARDS ||
+            (in[0] & ~(HEADER_PLAYS | HEADER_RAW))) {
+        return false;
+    }
+    log->dealt = true;
+    log->playCount = in[0] & HEADER_PLAYS;
+    BitReader r = { in, len, 1, 0, 0, false };
+    if (in[0] & HEADER_RAW) {
+        for (int i = 0; i < GAMELOG_CARDS; ++i) {
+            log->deck[i] = (uint8_t)bits_get(&r, CARD_BITS);
+        }
+        for (unsigned i = 0; i < log->playCount; ++i) {
+            log->plays[i] = (uint8_t)bits_get(&r, CARD_BITS);
+        }
+        for (int i = 0; i < GAMELOG_CARDS; ++i) {
+            if (log->deck[i] >= GAMELOG_CARDS ||
+                    (i < (int)log->playCount && log->plays[i] >= GAMELOG_CARDS)) {
+                return false;
+            }
+        }
+        return !r.overrun;
+    }
+    // Undealt cards in id order: the index'th is removed, the rest close up
+    uint8_t undealt[GAMELOG_CARDS];
+    for (int i = 0; i < GAMELOG_CARDS; ++i) {
+        undealt[i] = (uint8_t)i;
+    }
+    for (int i = 0; i < GAMELOG_CARDS; ++i) {
+        unsigned choices = (unsigned)(GAMELOG_CARDS - i);
+        unsigned index = get_choice(&r, choices);
+        if (index >= choices) {
+            return false;
+        }
+        log->deck[i] = undealt[index];
+        memmove(undealt + index, undealt + index + 1, choices - index - 1);
+    }
+    Replay replay;
+    deal(&replay, log->deck);
+    for (unsigned i = 0; i < log->playCount; ++i) {
+        uint64_t legal = legal_cards(&replay);
+        unsigned choices = count_cards(legal);
+        unsigned index = choices ? get_choice(&r, choices) : choices;
+        if (index >= choices) {
+            return false;
+        }
+        int card = select_bit(legal, index);
+        log->plays[i] = (uint8_t)card;
+        play_card(&replay, card);
+    }
+    return !r.overrun;
+}
+
+/**
+ * put_le / get_le
+ * ---------------
+ * Little-endian integers of `bytes` bytes in entry headers.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void put_le(uint8_t *out, uint64_t value, unsigned bytes) {
+    for (unsigned i = 0; i < bytes; ++i) {
+        out[i] = (uint8_t)(value >> (BITS_PER_BYTE * i));
+    }
+}
+
+static uint64_t get_le(const uint8_t *in, unsigned bytes) {
+    uint64_t value = 0;
+    for (unsigned i = 0; i < bytes; ++i) {
+        value |= (uint64_t)in[i] << (BITS_PER_BYTE * i);
+    }
+    return value;
+}
+
+/**
+ * gamelog_entry_build
+ * -------------------
+ * Builds one --game-log entry. Layout (integers little-endian):
+ *   u16  length of the rest of the entry
+ *   u64  finishedAt
+ *   u8   flags (bit 0: terminated)
+ *   u8   coded length
+ *   u8   name lengths: game, then seats 0..3
+ *   the five names, then the coded game
+ *
+ * Parameters:
+ *   log        - the game (dealt).
+ *   finishedAt - Unix time it ended.
+ *   terminated - it ended early.
+ *   gameName   - the game's name.
+ *   players    - player names by seat (NULL entries are stored empty).
+ *   out        - receives at most GAMELOG_ENTRY_MAX bytes.
+ *
+ * Returns:
+ *   Bytes written, or 0 for an undealt log.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+size_t gamelog_entry_build(const GameLog *log, uint64_t finishedAt, bool terminated,
+                           const char *gameName, char *const players[GAMELOG_SEATS],
+                           uint8_t out[GAMELOG_ENTRY_MAX]) {
+    uint8_t coded[GAMELOG_MAX_CODED];
+    size_t codedLen = gamelog_encode(log, coded);
+    if (codedLen == 0) {
+        return 0;
+    }
+    const char *names[GAMELOG_SEATS + 1] = { gameName };
+    memcpy(names + 1, players, sizeof *names * GAMELOG_SEATS);
+    size_t used = GAMELOG_ENTRY_HEADER;
+    for (int i = 0; i <= GAMELOG_SEATS; ++i) {
+        size_t len = names[i] ? strlen(names[i]) : 0;
+        if (len > GAMELOG_NAME_MAX) {
+            len = GAMELOG_NAME_MAX;
+        }
+        out[GAMELOG_ENTRY_HEADER - (GAMELOG_SEATS + 1) + i] = (uint8_t)len;
+        if (len > 0) {
+            memcpy(out + used, names[i], len);
+            used += len;
+        }
+    }
+    memcpy(out + used, coded, codedLen);
+    used += codedLen;
+    put_le(out, used - 2, 2);
+    put_le(out + 2, finishedAt, 8);
+    out[10] = terminated ? ENTRY_TERMINATED : 0;
+    out[11] = (uint8_t)codedLen;
+    return used;
+}
+
+/**
+ * gamelog_entry_parse
+ * -------------------
+ * Parses the entry at the start of buf without copying: names and the
+ * coded game point into buf.
+ *
+ * Parameters:
+ *   buf   - bytes of a --game-log file from an entry boundary.
+ *   len   - bytes available.
+ *   entry - receives the entry.
+ *
+ * Returns:
+ *   The entry's size in bytes, or 0 if buf does not hold a whole,
+ *   well-formed entry.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+size_t gamelog_entry_parse(const uint8_t *buf, size_t len, GameLogEntry *entry) {
+    if (len < GAMELOG_ENTRY_HEADER) {
+        return 0;
+    }
+    size_t size = (size_t)get_le(buf, 2) + 2;
+    if (size > len || size < GAMELOG_ENTRY_HEADER) {
+        return 0;
+    }
+    entry->finishedAt = get_le(buf + 2, 8);
+    entry->terminated = (buf[10] & ENTRY_TERMINATED) != 0;
+    entry->codedLen = buf[11];
+    size_t used = GAMELOG_ENTRY_HEADER;
+    GameLogName *names[GAMELOG_SEATS + 1] = { &entry->gameName };
+    for (int i = 0; i < GAMELOG_SEATS; ++i) {
+        names[i + 1] = &entry->players[i];
+    }
+    for (int i = 0; i <= GAMELOG_SEATS; ++i) {
+        names[i]->len = buf[GAMELOG_ENTRY_HEADER - (GAMELOG_SEATS + 1) + i];
+        names[i]->text = (const char *)buf + used;
+        used += names[i]->len;
+    }
+    if (used + entry->codedLen != size) {
+        return 0;
+    }
+    entry->coded = buf + used;
+    return size;
+}
@@ -0,0 +1,70 @@
+// gamelog.h — compact codec for finished games (ratsserver --game-log).
+//
+// A game is its deck and the cards in the order they were played. The
+// codec leans on the rules to store little more than the choices players
+// actually had: each deck card is an index among the cards not dealt yet,
+// and each play an index into the player's legal cards at that moment
+// (cards of the lead suit if the hand holds any, as has_suit_in_hand()
+// enforces in the server; otherwise the whole hand). A forced play costs
+// nothing. Indices are truncated binary codes, so n choices take
+// floor(log2 n) or ceil(log2 n) bits. Decoding replays the game.
+//
+// A deck that is not a permutation of the 52 cards, or a play the rules
+// do not allow, makes the game fall back to six bits per card.
+
+#ifndef GAMELOG_H
+#define GAMELOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define GAMELOG_SEATS 4
+#define GAMELOG_CARDS 52
+#define GAMELOG_MAX_CODED 79            // 1 + (52 + 52) * 6 / 8: a raw game
+#define GAMELOG_NAME_MAX 255            // longer names are cut in entries
+#define GAMELOG_ENTRY_HEADER 17         // length, time, flags, coded length, 5 name lengths
+#define GAMELOG_ENTRY_MAX \
+    (GAMELOG_ENTRY_HEADER + (GAMELOG_SEATS + 1) * GAMELOG_NAME_MAX + GAMELOG_MAX_CODED)
+
+// Card ids: suit * 13 + rank, suits in GAMELOG_SUITS order and ranks
+// lowest first, so each suit is 13 adjacent bits of a hand mask
+#define GAMELOG_SUITS "SCDH"
+#define GAMELOG_RANKS "23456789TJQKA"
+
+typedef struct {
+    bool dealt;                         // deck set; a game without one is not logged
+    uint8_t deck[GAMELOG_CARDS];        // card ids in deal order
+    uint8_t plays[GAMELOG_CARDS];       // card ids in the order they were played
+    unsigned playCount;
+} GameLog;
+
+// A name in a parsed entry: points into the entry, not NUL-terminated
+typedef struct {
+    const char *text;
+    unsigned len;
+} GameLogName;
+
+// One finished game as stored in a --game-log file (see
+// gamelog_entry_build() for the layout)
+typedef struct {
+    uint64_t finishedAt;                // Unix time, seconds
+    bool terminated;                    // ended before the last trick
+    GameLogName gameName;
+    GameLogName players[GAMELOG_SEATS]; // by seat
+    const uint8_t *coded;               // gamelog_encode() output
+    size_t codedLen;
+} GameLogEntry;
+
+int gamelog_card_id(char rank, char suit);
+void gamelog_card_text(int id, char *rankOut, char *suitOut);
+bool gamelog_set_deck(GameLog *log, const char *deckStr);
+void gamelog_add_play(GameLog *log, char rank, char suit);
+size_t gamelog_encode(const GameLog *log, uint8_t out[GAMELOG_MAX_CODED]);
+bool gamelog_decode(const uint8_t *in, size_t len, GameLog *log);
+size_t gamelog_entry_build(const GameLog *log, uint64_t finishedAt, bool terminated,
+                           const char *gameName, char *const players[GAMELOG_SEATS],
+                           uint8_t out[GAMELOG_ENTRY_MAX]);
+size_t gamelog_entry_parse(const uint8_t *buf, size_t len, GameLogEntry *entry);
+
+#endif
@@ -0,0 +1,306 @@
+// gamelogtest.c — round-trip checks for the game log codec (gamelog.h).
+// Run with "make -f MAKEFILE check"; exits non-zero if any check fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gamelog.h"
+
+#define RANDOM_GAMES 2000
+#define RANDOM_SEED 0x2310u
+#define RANKS 13
+#define LONG_NAME (GAMELOG_NAME_MAX + 40)
+#define FINISHED_AT 1700000000ull
+#define CODED_RAW 0x40u                 // byte 0 of a coded game: six bits per card
+
+// Counts of checks run and failed
+typedef struct {
+    unsigned run;
+    unsigned failed;
+} TestTally;
+
+static unsigned next_random(unsigned *state);
+static void random_deck(GameLog *log, unsigned *state);
+static void random_plays(GameLog *log, unsigned *state, unsigned count);
+static void check(TestTally *tally, bool ok, const char *what, unsigned game);
+static bool same_game(const GameLog *a, const GameLog *b);
+static bool round_trip(const GameLog *log, bool wantRaw);
+static void test_legal_games(TestTally *tally);
+static void test_raw_fallback(TestTally *tally);
+static void test_truncated(TestTally *tally);
+static void test_entries(TestTally *tally);
+
+/**
+ * next_random
+ * -----------
+ * xorshift32: a repeatable stream of pseudo-random numbers.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static unsigned next_random(unsigned *state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**
+ * random_deck
+ * -----------
+ * Deals a shuffled 52-card deck into log, with no plays yet.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void random_deck(GameLog *log, unsigned *state) {
+    memset(log, 0, sizeof *log);
+    for (int i = 0; i < GAMELOG_CARDS; ++i) {
+        log->deck[i] = (uint8_t)i;
+    }
+    for (int i = GAMELOG_CARDS - 1; i > 0; --i) {
+        int j = (int)(next_random(state) % (unsigned)(i + 1));
+        uint8_t card = log->deck[i];
+        log->deck[i] = log->deck[j];
+        log->deck[j] = card;
+    }
+    log->dealt = true;
+}
+
+/**
+ * random_plays
+ * ------------
+ * Plays `count` random legal cards from log's deal: card i of the deck
+ * goes to seat i % 4, seat 0 leads, players follow the lead suit when
+ * they can, and the highest card of the lead suit takes the trick. The
+ * rules are written out here rather than taken from gamelog.c, so the
+ * test does not share the codec's mistakes.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void random_plays(GameLog *log, unsigned *state, unsigned count) {
+    bool held[GAMELOG_SEATS][GAMELOG_CARDS] = { { false } };
+    for (int i = 0; i < GAMELOG_CARDS; ++i) {
+        held[i % GAMELOG_SEATS][log->deck[i]] = true;
+    }
+    int leader = 0;
+    int leadSuit = 0;
+    int bestRank = -1;
+    int bestSeat = 0;
+    for (unsigned p = 0; p < count; ++p) {
+        int seat = (leader + (int)(p % GAMELOG_SEATS)) % GAMELOG_SEATS;
+        int legal[GAMELOG_CARDS];
+        int choices = 0;
+        for (int card = 0; card < GAMELOG_CARDS; ++card) {
+            if (held[seat][card] && p % GAMELOG_SEATS != 0 && card / RANKS == leadSuit) {
+                legal[choices++] = card;
+            }
+        }
+        for (int card = 0; choices == 0 && card < GAMELOG_CARDS; ++card) {
+            if (held[seat][card]) {
+                legal[choices++] = card;
+            }
+        }
+        if (choices == 0) {
+            return;
+        }
+        int card = legal[next_random(state) % (unsigned)choices];
+        held[seat][card] = false;
+        log->plays[log->playCount++] = (uint8_t)card;
+        if (p % GAMELOG_SEATS == 0) {
+            leadSuit = card / RANKS;
+            bestRank = -1;
+        }
+        if (card / RANKS == leadSuit && card % RANKS > bestRank) {
+            bestRank = card % RANKS;
+            bestSeat = seat;
+        }
+        if (p % GAMELOG_SEATS == GAMELOG_SEATS - 1) {
+            leader = bestSeat;
+        }
+    }
+}
+
+/**
+ * check
+ * -----
+ * Records one check, reporting it on stderr if it failed.
+ *
+ * Parameters:
+ *   tally - counts to update.
+ *   ok    - whether the check passed.
+ *   what  - what was checked.
+ *   game  - which game (for random games), else 0.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void check(TestTally *tally, bool ok, const char *what, unsigned game) {
+    tally->run++;
+    if (!ok) {
+        tally->failed++;
+        fprintf(stderr, "FAIL: %s (game %u)\n", what, game);
+    }
+}
+
+/**
+ * same_game
+ * ---------
+ * Compares the deck and the plays of two logs.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool same_game(const GameLog *a, const GameLog *b) {
+    return a->dealt == b->dealt && a->playCount == b->playCount &&
+            memcmp(a->deck, b->deck, sizeof a->deck) == 0 &&
+            memcmp(a->plays, b->plays, a->playCount) == 0;
+}
+
+/**
+ * round_trip
+ * ----------
+ * Encodes a game, checks which form the codec chose, and decodes it.
+ *
+ * Parameters:
+ *   log     - the game.
+ *   wantRaw - whether the six-bit fallback is expected.
+ *
+ * Returns:
+ *   true if the form matches and the decoded game equals log.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool round_trip(const GameLog *log, bool wantRaw) {
+    uint8_t coded[GAMELOG_MAX_CODED];
+    size_t len = gamelog_encode(log, coded);
+    GameLog decoded;
+    memset(&decoded, 0, sizeof decoded);
+    return len > 0 && ((coded[0] & CODED_RAW) != 0) == wantRaw &&
+            gamelog_decode(coded, len, &decoded) &&
+            same_game(log, &decoded);
+}
+
+/**
+ * test_legal_games
+ * ----------------
+ * Random legal games of every length, from no plays to all 52, take the
+ * compact form and decode to the same deck and plays.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void test_legal_games(TestTally *tally) {
+    unsigned state = RANDOM_SEED;
+    for (unsigned game = 0; game < RANDOM_GAMES; ++game) {
+        GameLog log;
+        random_deck(&log, &state);
+        random_plays(&log, &state, game % (GAMELOG_CARDS + 1));
+        check(tally, round_trip(&log, false), "legal game round trip", game);
+    }
+}
+
+/**
+ * test_raw_fallback
+ * -----------------
+ * A deck with a repeated card, and a play the rules forbid, both fall
+ * back to six bits per card and still decode exactly.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void test_raw_fallback(TestTally *tally) {
+    unsigned state = RANDOM_SEED;
+    GameLog log;
+    random_deck(&log, &state);
+    random_plays(&log, &state, GAMELOG_CARDS);
+    log.deck[1] = log.deck[0];
+    check(tally, round_trip(&log, true), "repeated deck card round trip", 0);
+
+    random_deck(&log, &state);
+    // Seat 0 leads a card from seat 1's hand
+    log.plays[log.playCount++] = log.deck[1];
+    check(tally, round_trip(&log, true), "illegal play round trip", 0);
+
+    uint8_t coded[GAMELOG_MAX_CODED];
+    GameLog undealt;
+    memset(&undealt, 0, sizeof undealt);
+    check(tally, gamelog_encode(&undealt, coded) == 0, "game without a deal not coded", 0);
+}
+
+/**
+ * test_truncated
+ * --------------
+ * A coded game cut short by a byte, in either form, fails to decode.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void test_truncated(TestTally *tally) {
+    unsigned state = RANDOM_SEED;
+    for (int raw = 0; raw <= 1; ++raw) {
+        GameLog log;
+        random_deck(&log, &state);
+        random_plays(&log, &state, GAMELOG_CARDS);
+        if (raw) {
+            log.deck[1] = log.deck[0];
+        }
+        uint8_t coded[GAMELOG_MAX_CODED];
+        size_t len = gamelog_encode(&log, coded);
+        GameLog decoded;
+        check(tally, len > 1 && !gamelog_decode(coded, len - 1, &decoded),
+              raw ? "truncated raw game rejected" : "truncated game rejected", 0);
+    }
+}
+
+/**
+ * test_entries
+ * ------------
+ * A --game-log entry parses back to its time, outcome, names (a missing
+ * name as empty, a long one cut to GAMELOG_NAME_MAX) and game; two
+ * entries back to back parse one after the other, and a partial entry
+ * is refused.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void test_entries(TestTally *tally) {
+    unsigned state = RANDOM_SEED;
+    GameLog log;
+    random_deck(&log, &state);
+    random_plays(&log, &state, GAMELOG_CARDS - GAMELOG_SEATS);
+    char longName[LONG_NAME + 1];
+    memset(longName, 'x', LONG_NAME);
+    longName[LONG_NAME] = '\0';
+    char *players[GAMELOG_SEATS] = { "ann", NULL, longName, "dee" };
+
+    uint8_t buf[2 * GAMELOG_ENTRY_MAX];
+    size_t first = gamelog_entry_build(&log, FINISHED_AT, true, "table", players, buf);
+    size_t second = gamelog_entry_build(&log, FINISHED_AT + 1, false, "", players,
+                                        buf + first);
+    check(tally, first > 0 && second > 0, "entries built", 0);
+
+    GameLogEntry entry;
+    GameLog decoded;
+    memset(&decoded, 0, sizeof decoded);
+    check(tally, gamelog_entry_parse(buf, first + second, &entry) == first,
+          "first entry size", 0);
+    check(tally, entry.finishedAt == FINISHED_AT && entry.terminated, "first entry header", 0);
+    check(tally, entry.gameName.len == 5 && memcmp(entry.gameName.text, "table", 5) == 0,
+          "game name", 0);
+    check(tally, entry.players[0].len == 3 && memcmp(entry.players[0].text, "ann", 3) == 0 &&
+          entry.players[1].len == 0 && entry.players[2].len == GAMELOG_NAME_MAX &&
+          entry.players[3].len == 3, "player names", 0);
+    check(tally, gamelog_decode(entry.coded, entry.codedLen, &decoded) &&
+          same_game(&log, &decoded), "entry game", 0);
+
+    check(tally, gamelog_entry_parse(buf + first, second, &entry) == second &&
+          entry.finishedAt == FINISHED_AT + 1 && !entry.terminated &&
+          entry.gameName.len == 0, "second entry", 0);
+    check(tally, gamelog_entry_parse(buf, first - 1, &entry) == 0,
+          "partial entry refused", 0);
+}
+
+int main(void) {
+    TestTally tally = { 0, 0 };
+    test_legal_games(&tally);
+    test_raw_fallback(&tally);
+    test_truncated(&tally);
+    test_entries(&tally);
+    printf("gamelogtest: %u checks, %u failed\n", tally.run, tally.failed);
+    return tally.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,92 @@
+#!/bin/bash
+# pgo.sh — profile-guided build of ratsserver/ratsclient.
+#
+#   1. builds a plain -O2 reference copy (for the before/after comparison)
+#   2. builds instrumented binaries (make pgo-instrument)
+#   3. trains them: full games, lobby churn, malformed input via ratsbench,
+#      plus a few games driven through the real ratsclient
+#   4. rebuilds with the collected profiles (make pgo-optimised)
+#   5. runs the e2e benchmark against both servers and reports the speedup
+#
+# Usage: ./pgo.sh [bench-games] [bench-concurrency]
+
+set -euo pipefail
+cd "$(dirname "$0")"
+
+BENCH_GAMES=${1:-2000}
+BENCH_CONC=${2:-16}
+TRAIN_GAMES=400
+REF_DIR=pgo-ref
+MK="make -f MAKEFILE"
+
+# start_server BINARY -> sets SERVER_PID and SERVER_PORT
+start_server() {
+    local portFile
+    portFile=$(mktemp)
+    "$1" 0 pgo 2>"$portFile" &
+    SERVER_PID=$!
+    for _ in $(seq 100); do
+        SERVER_PORT=$(head -n1 "$portFile")
+        [ -n "$SERVER_PORT" ] && break
+        sleep 0.05
+    done
+    rm -f "$portFile"
+    [ -n "$SERVER_PORT" ] || { echo "pgo.sh: server did not start" >&2; exit 1; }
+}
+
+stop_server() {
+    kill -TERM "$SERVER_PID" 2>/dev/null || true
+    wait "$SERVER_PID" 2>/dev/null || true
+}
+
+# Feeds every card 13 times over; ratsclient skips cards it can't play
+client_script() {
+    for _ in $(seq 13); do
+        for s in S C D H; do
+            for r in 2 3 4 5 6 7 8 9 T J Q K A; do
+                echo "$r$s"
+            done
+        done
+    done
+}
+
+echo "== reference -O2 build"
+$MK clean >/dev/null
+$MK all OPTFLAGS=-O2 >/dev/null
+rm -rf "$REF_DIR" && mkdir "$REF_DIR"
+cp ratsserver ratsbench "$REF_DIR"/
+
+echo "== instrumented build"
+$MK pgo-instrument >/dev/null
+
+echo "== training"
+start_server ./ratsserver
+"$REF_DIR"/ratsbench "$SERVER_PORT" full "$TRAIN_GAMES" 8 >/dev/null
+"$REF_DIR"/ratsbench "$SERVER_PORT" churn "$TRAIN_GAMES" 8 >/dev/null
+"$REF_DIR"/ratsbench "$SERVER_PORT" malformed "$TRAIN_GAMES" 8 >/dev/null
+for g in 1 2 3; do
+    for p in north east south west; do
+        client_script | ./ratsclient "$p" "pgo-client-$g" "$SERVER_PORT" \
+            >/dev/null 2>&1 &
+    done
+    wait $(jobs -p | grep -v "^$SERVER_PID\$") 2>/dev/null || true
+done
+stop_server
+
+echo "== optimised build"
+$MK pgo-optimised >/dev/null
+
+bench() {
+    start_server "$1"
+    "$REF_DIR"/ratsbench "$SERVER_PORT" full "$BENCH_GAMES" "$BENCH_CONC" |
+        awk -F': ' '/games\/sec/ {print $2}'
+    stop_server
+}
+
+echo "== e2e benchmark ($BENCH_GAMES games, concurrency $BENCH_CONC)"
+REF_RATE=$(bench "$REF_DIR"/ratsserver)
+PGO_RATE=$(bench ./ratsserver)
+echo "reference -O2: $REF_RATE games/sec"
+echo "PGO:           $PGO_RATE games/sec"
+awk -v a="$REF_RATE" -v b="$PGO_RATE" \
+    'BEGIN { if (a > 0) printf "speedup:       %.3fx\n", b / a }'
@@ -0,0 +1,699 @@
+#include <stdio.h>      // for fprintf, snprintf
+#include <stdlib.h>     // for exit, malloc, realloc, free, strtoul
+#include <string.h>     // for memchr, memcpy, memmove, strrchr
+#include <sys/types.h>  // for socket types
+#include <sys/socket.h> // for socket(), accept(), recv(), send()
+#include <sys/epoll.h>  // for the event loop
+#include <netdb.h>      // for getaddrinfo(), freeaddrinfo(), struct addrinfo
+#include <netinet/in.h>   // for IPPROTO_TCP, struct sockaddr_in
+#include <netinet/tcp.h>  // for TCP_NODELAY
+#include <arpa/inet.h>  // for ntohs()
+#include <unistd.h>     // for close()
+#include <fcntl.h>      // for fcntl(), O_NONBLOCK
+#include <signal.h>     // for ignoring SIGPIPE
+#include <stdbool.h>
+#include <errno.h>
+
+#define USAGE_EXIT 3
+#define PORT_EXIT 1
+#define LISTEN_EXIT 6
+#define CONNECT_EXIT 5
+
+#define MIN_ARGC 3
+#define MAX_ARGC 4
+#define ARG_PORT 1
+#define ARG_SERVER 2
+#define ARG_LINKS 3
+
+#define DEFAULT_LINKS 4
+#define MAX_LINKS 64
+#define MAX_HOST 256
+#define MAX_PORT 32
+
+// Frame format shared with ratsserver --mux-port (see mux_handle_frames)
+#define MUX_CHUNK_MAX 4096          // largest payload of one D frame
+#define MUX_HEADER_MAX 48           // "D<id> <len>\n"
+#define CLIENT_BUCKETS 4096         // client hash buckets per link
+#define LINK_BACKLOG_MAX (8u << 20) // unsent bytes a link may hold
+#define EPOLL_BATCH 128
+
+typedef enum {
+    ENDPOINT_LISTENER,
+    ENDPOINT_LINK,
+    ENDPOINT_CLIENT
+} EndpointKind;
+
+struct Link;
+
+// One player's TCP connection, carried as channel `id` on `link`.
+typedef struct Client {
+    EndpointKind kind;              // ENDPOINT_CLIENT; first, for epoll dispatch
+    int fd;
+    unsigned long id;
+    struct Link *link;
+    struct Client *nextInBucket;    // also links closed clients awaiting free
+} Client;
+
+// One long-lived connection to ratsserver's mux port.
+typedef struct Link {
+    EndpointKind kind;              // ENDPOINT_LINK
+    int fd;                         // -1 while down
+    unsigned long nextId;
+    unsigned clients;
+    Client *buckets[CLIENT_BUCKETS];
+    char *out;                      // frames not yet accepted by the kernel
+    size_t outLen;
+    size_t outCap;
+    bool wantWrite;                 // EPOLLOUT registered
+    size_t pending;                 // partial frame from the server in in[]
+    char in[MUX_HEADER_MAX + MUX_CHUNK_MAX];
+} Link;
+
+// All gateway state; single-threaded, passed around (no globals).
+typedef struct {
+    int epollFd;
+    char host[MAX_HOST];
+    char port[MAX_PORT];
+    Link *links;
+    unsigned linkCount;
+    unsigned nextLink;              // round-robin cursor
+    Client *closed;                 // freed once the current event batch is done
+    EndpointKind listenerKind;      // epoll tag for the listening socket
+} Gateway;
+
+static void die_usage(void);
+static int listen_and_report_port(const char *service);
+static int connect_server(const Gateway *gw);
+static void set_nonblocking(int fd);
+static bool link_connect(Gateway *gw, Link *link);
+static void link_down(Gateway *gw, Link *link);
+static void link_update_events(Gateway *gw, Link *link);
+static bool link_flush(Gateway *gw, Link *link);
+static bool link_queue(Gateway *gw, Link *link, const char *header, size_t headerLen,
+                       const char *data, size_t dataLen);
+static Client *client_find(Link *link, unsigned long id);
+static void client_close(Gateway *gw, Client *client, bool tellServer);
+static void accept_clients(Gateway *gw, int listenFd);
+static void client_readable(Gateway *gw, Client *client);
+static bool link_handle_frames(Gateway *gw, Link *link);
+static void link_readable(Gateway *gw, Link *link);
+
+/**
+ * die_usage
+ * ---------
+ * Prints the gateway usage message to stderr and terminates.
+ *
+ * Returns:
+ *   None (does not return; exits with status 3).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void die_usage(void) {
+    fprintf(stderr, "Usage: ./ratsgateway port [host:]muxport [links]\n");
+    exit(USAGE_EXIT);
+}
+
+/**
+ * listen_and_report_port
+ * ----------------------
+ * Creates the IPv4 TCP listening socket players connect to and prints the
+ * bound port number to stderr, as ratsserver does.
+ *
+ * Parameters:
+ *   service - port or service name ("0" picks a free port).
+ *
+ * Returns:
+ *   The listening socket; exits with status 1 (bad port) or 6 (unable
+ *   to listen) on failure.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int listen_and_report_port(const char *service) {
+    struct addrinfo hints, *res = NULL, *rp = NULL;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(NULL, service, &hints, &res) != 0) {
+        fprintf(stderr, "ratsgateway: port invalid\n");
+        exit(PORT_EXIT);
+    }
+    int lfd = -1;
+    int yes = 1;
+    for (rp = res; rp; rp = rp->ai_next) {
+        lfd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (lfd < 0) continue;
+        setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+        if (bind(lfd, rp->ai_addr, rp->ai_addrlen) == 0 && listen(lfd, SOMAXCONN) == 0) {
+            break;
+        }
+        close(lfd);
+        lfd = -1;
+    }
+    freeaddrinfo(res);
+    if (lfd < 0) {
+        fprintf(stderr, "ratsgateway: unable to listen on given port \"%s\"\n", service);
+        exit(LISTEN_EXIT);
+    }
+    struct sockaddr_in sin;
+    socklen_t slen = sizeof sin;
+    if (getsockname(lfd, (struct sockaddr *)&sin, &slen) == 0) {
+        fprintf(stderr, "%u\n", (unsigned)ntohs(sin.sin_port));
+        fflush(stderr);
+    }
+    return lfd;
+}
+
+/**
+ * connect_server
+ * --------------
+ * Opens one TCP connection to ratsserver's mux port.
+ *
+ * Parameters:
+ *   gw - gateway (host and port of the server).
+ *
+ * Returns:
+ *   Connected socket, or -1.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int connect_server(const Gateway *gw) {
+    struct addrinfo hints, *res = NULL, *rp = NULL;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(gw->host, gw->port, &hints, &res) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (rp = res; rp; rp = rp->ai_next) {
+        fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, rp->ai_addr, rp->ai_addrlen) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+/**
+ * set_nonblocking
+ * ---------------
+ * Puts a socket in non-blocking mode; the event loop never waits on a
+ * single peer.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void set_nonblocking(int fd) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/**
+ * link_connect
+ * ------------
+ * (Re)connects a link that is down and adds it to the event loop.
+ *
+ * Parameters:
+ *   gw   - gateway.
+ *   link - a link with fd == -1.
+ *
+ * Returns:
+ *   true if the link is now up.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool link_connect(Gateway *gw, Link *link) {
+    int fd = connect_server(gw);
+    if (fd < 0) {
+        return false;
+    }
+    set_nonblocking(fd);
+    link->fd = fd;
+    link->pending = 0;
+    link->outLen = 0;
+    link->wantWrite = false;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = link };
+    if (epoll_ctl(gw->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        link->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * link_down
+ * ---------
+ * Handles a lost link: every player on it is disconnected (the server has
+ * already seen them all hang up) and the link is reconnected the next
+ * time a player is assigned to it.
+ *
+ * Parameters:
+ *   gw   - gateway.
+ *   link - the failed link.
+ *
+ * Returns:
+ *   None.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void link_down(Gateway *gw, Link *link) {
+    if (link->fd < 0) {
+        return;
+    }
+    fprintf(stderr, "ratsgateway: server link lost, %u player(s) disconnected\n",
+            link->clients);
+    epoll_ctl(gw->epollFd, EPOLL_CTL_DEL, link->fd, NULL);
+    close(link->fd);
+    link->fd = -1;
+    for (unsigned b = 0; b < CLIENT_BUCKETS; ++b) {
+        while (link->buckets[b]) {
+            client_close(gw, link->buckets[b], false);
+        }
+    }
+    link->outLen = 0;
+    link->pending = 0;
+}
+
+/**
+ * link_update_events
+ * ------------------
+ * Asks for EPOLLOUT on a link only while it has unsent frames.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void link_update_events(Gateway *gw, Link *link) {
+    bool want = link->outLen > 0;
+    if (want == link->wantWrite || link->fd < 0) {
+        return;
+    }
+    struct epoll_event ev = { .events = EPOLLIN | (want ? EPOLLOUT : 0u), .data.ptr = link };
+    epoll_ctl(gw->epollFd, EPOLL_CTL_MOD, link->fd, &ev);
+    link->wantWrite = want;
+}
+
+/**
+ * link_flush
+ * ----------
+ * Sends as much of a link's queued frames as the kernel will take now.
+ *
+ * Parameters:
+ *   gw   - gateway.
+ *   link - an up link.
+ *
+ * Returns:
+ *   false if the link failed (it has been taken down).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool link_flush(Gateway *gw, Link *link) {
+    size_t sent = 0;
+    while (sent < link->outLen) {
+        ssize_t n = send(link->fd, link->out + sent, link->outLen - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            break;
+        }
+        if (n <= 0) {
+            link_down(gw, link);
+            return false;
+        }
+        sent += (size_t)n;
+    }
+    memmove(link->out, link->out + sent, link->outLen - sent);
+    link->outLen -= sent;
+    link_update_events(gw, link);
+    return true;
+}
+
+/**
+ * link_queue
+ * ----------
+ * Appends one frame (header plus optional payload) to a link and tries
+ * to send it at once. The gateway never blocks on the server, so it
+ * always keeps reading what the server sends back.
+ *
+ * Parameters:
+ *   gw        - gateway.
+ *   link      - an up link.
+ *   header    - frame header, newline included.
+ *   headerLen - its length.
+ *   data      - payload, or NULL.
+ *   dataLen   - payload length.
+ *
+ * Returns:
+ *   false if the frame could not be queued (the link is backed up by
+ *   more than LINK_BACKLOG_MAX, or memory ran out) or the link failed.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool link_queue(Gateway *gw, Link *link, const char *header, size_t headerLen,
+                       const char *data, size_t dataLen) {
+    size_t need = link->outLen + headerLen + dataLen;
+    if (need > LINK_BACKLOG_MAX) {
+        return false;
+    }
+    if (need > link->outCap) {
+        size_t cap = link->outCap ? link->outCap : MUX_HEADER_MAX + MUX_CHUNK_MAX;
+        while (cap < need) {
+            cap *= 2;
+        }
+        char *grown = realloc(link->out, cap);
+        if (!grown) {
+            return false;
+        }
+        link->out = grown;
+        link->outCap = cap;
+    }
+    memcpy(link->out + link->outLen, header, headerLen);
+    if (dataLen > 0) {
+        memcpy(link->out + link->outLen + headerLen, data, dataLen);
+    }
+    link->outLen = need;
+    return link_flush(gw, link);
+}
+
+/**
+ * client_find
+ * -----------
+ * Looks up the player on channel `id` of a link.
+ *
+ * Returns:
+ *   The client, or NULL.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static Client *client_find(Link *link, unsigned long id) {
+    Client *client = link->buckets[id % CLIENT_BUCKETS];
+    while (client && client->id != id) {
+        client = client->nextInBucket;
+    }
+    return client;
+}
+
+/**
+ * client_close
+ * ------------
+ * Disconnects a player and forgets their channel. The Client itself is
+ * freed by the event loop after the current batch of events.
+ *
+ * Parameters:
+ *   gw         - gateway.
+ *   client     - the player.
+ *   tellServer - send a close frame so the server sees the hang-up.
+ *
+ * Returns:
+ *   None.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void client_close(Gateway *gw, Client *client, bool tellServer) {
+    Link *link = client->link;
+    Client **cursor = &link->buckets[client->id % CLIENT_BUCKETS];
+    while (*cursor && *cursor != client) {
+        cursor = &(*cursor)->nextInBucket;
+    }
+    if (*cursor) {
+        *cursor = client->nextInBucket;
+    }
+    link->clients--;
+    epoll_ctl(gw->epollFd, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    // Later events in this batch may still name the client
+    client->fd = -1;
+    client->nextInBucket = gw->closed;
+    gw->closed = client;
+    if (tellServer && link->fd >= 0) {
+        char header[MUX_HEADER_MAX];
+        int n = snprintf(header, sizeof header, "C%lu\n", client->id);
+        (void)link_queue(gw, link, header, (size_t)n, NULL, 0);
+    }
+}
+
+/**
+ * accept_clients
+ * --------------
+ * Accepts every waiting player, assigns each to the next link round-robin
+ * (reconnecting a link that is down) and opens a channel for them. The
+ * server then sends the greeting down that channel, so the player sees
+ * the same protocol as a direct connection.
+ *
+ * Parameters:
+ *   gw       - gateway.
+ *   listenFd - non-blocking listening socket.
+ *
+ * Returns:
+ *   None. A player no link can carry is disconnected.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void accept_clients(Gateway *gw, int listenFd) {
+    for (;;) {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        Link *link = NULL;
+        for (unsigned tried = 0; tried < gw->linkCount && !link; ++tried) {
+            Link *candidate = &gw->links[gw->nextLink];
+            gw->nextLink = (gw->nextLink + 1) % gw->linkCount;
+            if (candidate->fd >= 0 || link_connect(gw, candidate)) {
+                link = candidate;
+            }
+        }
+        Client *client = link ? malloc(sizeof *client) : NULL;
+        if (!client) {
+            close(fd);
+            continue;
+        }
+        set_nonblocking(fd);
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        client->kind = ENDPOINT_CLIENT;
+        client->fd = fd;
+        client->id = link->nextId++;
+        client->link = link;
+        client->nextInBucket = link->buckets[client->id % CLIENT_BUCKETS];
+        link->buckets[client->id % CLIENT_BUCKETS] = client;
+        link->clients++;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = client };
+        char header[MUX_HEADER_MAX];
+        int n = snprintf(header, sizeof header, "O%lu\n", client->id);
+        if (epoll_ctl(gw->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0 ||
+                !link_queue(gw, link, header, (size_t)n, NULL, 0)) {
+            if (link->fd >= 0) {
+                client_close(gw, client, false);
+            }
+        }
+    }
+}
+
+/**
+ * client_readable
+ * ---------------
+ * Forwards what a player sent as a D frame on their link; a player who
+ * has hung up becomes a C frame.
+ *
+ * Parameters:
+ *   gw     - gateway.
+ *   client - readable player.
+ *
+ * Returns:
+ *   None.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void client_readable(Gateway *gw, Client *client) {
+    char data[MUX_CHUNK_MAX];
+    ssize_t n = recv(client->fd, data, sizeof data, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+    if (n <= 0) {
+        client_close(gw, client, true);
+        return;
+    }
+    Link *link = client->link;
+    char header[MUX_HEADER_MAX];
+    int h = snprintf(header, sizeof header, "D%lu %zd\n", client->id, n);
+    if (!link_queue(gw, link, header, (size_t)h, data, (size_t)n) && link->fd >= 0) {
+        client_close(gw, client, true);     // link backed up: drop this player only
+    }
+}
+
+/**
+ * link_handle_frames
+ * ------------------
+ * Acts on every complete frame buffered from the server:
+ *   D<id> <len>\n<bytes>  bytes for the player on channel id
+ *   C<id>\n               the server closed that player's connection
+ *
+ * Parameters:
+ *   gw   - gateway.
+ *   link - link with newly read bytes.
+ *
+ * Returns:
+ *   true to keep the link; false on a malformed frame.
+ *
+ * Notes:
+ *   Bytes go to the player without blocking. The server sends a few
+ *   short lines per trick, so a player whose socket buffer is full has
+ *   stopped reading; they are disconnected rather than holding up the
+ *   whole link.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool link_handle_frames(Gateway *gw, Link *link) {
+    size_t used = 0;
+    while (used < link->pending) {
+        char *frame = link->in + used;
+        size_t avail = link->pending - used;
+        char *newline = memchr(frame, '\n', avail < MUX_HEADER_MAX ? avail : MUX_HEADER_MAX);
+        if (!newline) {
+            if (avail >= MUX_HEADER_MAX) {
+                return false;
+            }
+            break;
+        }
+        *newline = '\0';
+        char *end = NULL;
+        unsigned long id = strtoul(frame + 1, &end, 10);
+        size_t headerLen = (size_t)(newline - frame) + 1;
+        Client *client = NULL;
+        if (frame[0] == 'D') {
+            unsigned long len = end && *end == ' ' ? strtoul(end + 1, &end, 10) : 0;
+            if (len == 0 || len > MUX_CHUNK_MAX || *end != '\0') {
+                return false;
+            }
+            if (avail < headerLen + len) {
+                *newline = '\n';
+                break;
+            }
+            client = client_find(link, id);
+            if (client) {
+                ssize_t n = send(client->fd, newline + 1, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n != (ssize_t)len) {
+                    client_close(gw, client, true);
+                }
+            }
+            used += headerLen + len;
+            continue;
+        }
+        if (frame[0] != 'C' || !end || *end != '\0') {
+            return false;
+        }
+        client = client_find(link, id);
+        if (client) {
+            client_close(gw, client, false);
+        }
+        used += headerLen;
+    }
+    memmove(link->in, link->in + used, link->pending - used);
+    link->pending -= used;
+    return true;
+}
+
+/**
+ * link_readable
+ * -------------
+ * Reads from the server link and dispatches the frames; a closed link or
+ * a malformed frame takes the link down.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void link_readable(Gateway *gw, Link *link) {
+    ssize_t n = recv(link->fd, link->in + link->pending, sizeof link->in - link->pending, 0);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+    if (n <= 0) {
+        link_down(gw, link);
+        return;
+    }
+    link->pending += (size_t)n;
+    if (!link_handle_frames(gw, link)) {
+        fprintf(stderr, "ratsgateway: malformed frame from server\n");
+        link_down(gw, link);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < MIN_ARGC || argc > MAX_ARGC || !*argv[ARG_PORT] || !*argv[ARG_SERVER]) {
+        die_usage();
+    }
+    Gateway gw;
+    memset(&gw, 0, sizeof gw);
+    const char *server = argv[ARG_SERVER];
+    const char *colon = strrchr(server, ':');
+    snprintf(gw.host, sizeof gw.host, "%.*s", colon ? (int)(colon - server) : 9,
+             colon ? server : "localhost");
+    snprintf(gw.port, sizeof gw.port, "%s", colon ? colon + 1 : server);
+    gw.linkCount = DEFAULT_LINKS;
+    if (argc > ARG_LINKS) {
+        char *end = NULL;
+        unsigned long v = strtoul(argv[ARG_LINKS], &end, 10);
+        if (*end || v == 0 || v > MAX_LINKS) {
+            die_usage();
+        }
+        gw.linkCount = (unsigned)v;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenFd = listen_and_report_port(argv[ARG_PORT]);
+    set_nonblocking(listenFd);
+    gw.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    gw.links = calloc(gw.linkCount, sizeof *gw.links);
+    if (gw.epollFd < 0 || !gw.links) {
+        exit(CONNECT_EXIT);
+    }
+    unsigned up = 0;
+    for (unsigned i = 0; i < gw.linkCount; ++i) {
+        gw.links[i].kind = ENDPOINT_LINK;
+        gw.links[i].fd = -1;
+        up += link_connect(&gw, &gw.links[i]) ? 1u : 0u;
+    }
+    if (up == 0) {
+        fprintf(stderr, "ratsgateway: unable to connect to the server\n");
+        exit(CONNECT_EXIT);
+    }
+    gw.listenerKind = ENDPOINT_LISTENER;
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &gw.listenerKind };
+    epoll_ctl(gw.epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+    for (;;) {
+        struct epoll_event events[EPOLL_BATCH];
+        int ready = epoll_wait(gw.epollFd, events, EPOLL_BATCH, -1);
+        for (int i = 0; i < ready; ++i) {
+            EndpointKind *kind = events[i].data.ptr;
+            if (*kind == ENDPOINT_LISTENER) {
+                accept_clients(&gw, listenFd);
+            } else if (*kind == ENDPOINT_LINK) {
+                Link *link = (Link *)kind;
+                if (link->fd < 0 ||
+                        ((events[i].events & EPOLLOUT) && !link_flush(&gw, link))) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    link_readable(&gw, link);
+                }
+            } else if (((Client *)kind)->fd >= 0) {
+                client_readable(&gw, (Client *)kind);
+            }
+        }
+        while (gw.closed) {
+            Client *client = gw.closed;
+            gw.closed = client->nextInBucket;
+            free(client);
+        }
+    }
+}
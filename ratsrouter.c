@@ -0,0 +1,697 @@
+#define _GNU_SOURCE     // for splice()
+#include <stdio.h>      // for fprintf, fopen, getline
+#include <stdlib.h>     // for exit, malloc, free, qsort
+#include <string.h>     // for memcpy, strrchr, strlen
+#include <sys/types.h>  // for socket types
+#include <sys/socket.h> // for socket(), accept(), recv(), send(), shutdown()
+#include <netdb.h>      // for getaddrinfo(), freeaddrinfo(), struct addrinfo
+#include <netinet/in.h>   // for IPPROTO_TCP, struct sockaddr_in
+#include <netinet/tcp.h>  // for TCP_NODELAY
+#include <arpa/inet.h>  // for ntohs()
+#include <unistd.h>     // for close(), pipe()
+#include <fcntl.h>      // for splice(), SPLICE_F_*
+#include <poll.h>       // for poll()
+#include <pthread.h>    // for per-connection threads
+#include <signal.h>     // for SIGHUP/SIGPIPE masks, sigwait()
+#include <stdatomic.h>  // for routing counters
+#include <stdbool.h>
+#include <stdint.h>     // for uint64_t
+#include <errno.h>
+
+#define USAGE_EXIT 3
+#define PORT_EXIT 1
+#define LISTEN_EXIT 6
+#define BACKENDS_EXIT 4
+
+#define ARGC 3
+#define ARG_PORT 1
+#define ARG_BACKENDS 2
+
+#define MAX_BACKENDS 256
+#define MAX_HOST 256
+#define MAX_PORT 32
+#define RING_VNODES 160             // ring points per backend
+#define RING_KEY_SIZE (MAX_HOST + MAX_PORT + 16)
+#define MAX_JOIN_BYTES 4096         // both join lines must fit in this
+#define JOIN_LINES 2                // player name, game name
+#define SPLICE_CHUNK 65536          // bytes moved per splice() call
+
+// One ratsserver instance the router can send games to.
+typedef struct {
+    char host[MAX_HOST];
+    char port[MAX_PORT];
+} Backend;
+
+// A backend's position on the hash ring.
+typedef struct {
+    uint64_t point;
+    unsigned backend;
+} RingPoint;
+
+// Consistent-hash ring built from one backend list. Replaced whole on
+// reload, never modified in place.
+typedef struct {
+    Backend *backends;
+    unsigned backendCount;
+    RingPoint *points;              // sorted by point
+    unsigned pointCount;
+} HashRing;
+
+// All router state; passed to every thread (no globals).
+typedef struct {
+    const char *backendFile;        // re-read on SIGHUP
+    HashRing *ring;                 // guarded by ringMutex
+    pthread_mutex_t ringMutex;
+    atomic_ulong routed;            // clients connected to a backend
+    atomic_ulong unroutable;        // clients no backend would take
+} RouterCtx;
+
+typedef struct {
+    RouterCtx *ctx;
+    int fd;
+} ConnArg;
+
+static void die_usage(void);
+static int listen_and_report_port(const char *service);
+static uint64_t hash_key(const char *key, size_t len);
+static int compare_points(const void *a, const void *b);
+static HashRing *load_ring(const char *path);
+static void free_ring(HashRing *ring);
+static unsigned route_candidates(RouterCtx *ctx, const char *gameName, size_t len,
+                                 Backend *out);
+static int connect_backend(const Backend *backend);
+static bool read_join_lines(int fd, char *buf, size_t *lenOut, const char **gameOut,
+                            size_t *gameLenOut);
+static bool send_all(int fd, const char *buf, size_t len);
+static void relay(int clientFd, int backendFd);
+static void *connection_thread(void *arg);
+static void *reload_thread(void *arg);
+
+/**
+ * die_usage
+ * ---------
+ * Prints the router usage message to stderr and terminates.
+ *
+ * Returns:
+ *   None (does not return; exits with status 3).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void die_usage(void) {
+    fprintf(stderr, "Usage: ./ratsrouter port backendfile\n");
+    exit(USAGE_EXIT);
+}
+
+/**
+ * listen_and_report_port
+ * ----------------------
+ * Creates an IPv4 TCP listening socket and prints the bound port number
+ * to stderr, exactly as ratsserver does, so scripts can drive either.
+ *
+ * Parameters:
+ *   service - port or service name ("0" picks a free port).
+ *
+ * Returns:
+ *   The listening socket; exits with status 1 (bad port) or 6 (unable
+ *   to listen) on failure.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int listen_and_report_port(const char *service) {
+    struct addrinfo hints, *res = NULL, *rp = NULL;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    if (getaddrinfo(NULL, service, &hints, &res) != 0) {
+        fprintf(stderr, "ratsrouter: port invalid\n");
+        exit(PORT_EXIT);
+    }
+    int lfd = -1;
+    int yes = 1;
+    for (rp = res; rp; rp = rp->ai_next) {
+        lfd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (lfd < 0) continue;
+        setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+        if (bind(lfd, rp->ai_addr, rp->ai_addrlen) == 0 && listen(lfd, SOMAXCONN) == 0) {
+            break;
+        }
+        close(lfd);
+        lfd = -1;
+    }
+    freeaddrinfo(res);
+    if (lfd < 0) {
+        fprintf(stderr, "ratsrouter: unable to listen on given port \"%s\"\n", service);
+        exit(LISTEN_EXIT);
+    }
+    struct sockaddr_in sin;
+    socklen_t slen = sizeof sin;
+    if (getsockname(lfd, (struct sockaddr *)&sin, &slen) == 0) {
+        fprintf(stderr, "%u\n", (unsigned)ntohs(sin.sin_port));
+        fflush(stderr);
+    }
+    return lfd;
+}
+
+/**
+ * hash_key
+ * --------
+ * 64-bit FNV-1a followed by a splitmix64 finaliser, so short, similar
+ * keys ("game1", "game2", "host:port#7") still spread over the ring.
+ *
+ * Parameters:
+ *   key - bytes to hash.
+ *   len - number of bytes.
+ *
+ * Returns:
+ *   The hash.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static uint64_t hash_key(const char *key, size_t len) {
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < len; ++i) {
+        h = (h ^ (unsigned char)key[i]) * 1099511628211ull;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    h ^= h >> 31;
+    return h;
+}
+
+/**
+ * compare_points
+ * --------------
+ * qsort() comparator ordering ring points by position.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int compare_points(const void *a, const void *b) {
+    uint64_t pa = ((const RingPoint *)a)->point;
+    uint64_t pb = ((const RingPoint *)b)->point;
+    return pa < pb ? -1 : pa > pb;
+}
+
+/**
+ * load_ring
+ * ---------
+ * Reads the backend list and builds its hash ring. Each line names one
+ * ratsserver as "host:port" or just "port" (localhost); blank lines and
+ * lines starting with '#' are skipped. Every backend gets RING_VNODES
+ * points hashed from its own name, so adding or removing one backend
+ * only moves the games whose nearest point belonged to it (about 1/N of
+ * them); the rest keep their backend.
+ *
+ * Parameters:
+ *   path - backend list file.
+ *
+ * Returns:
+ *   A new ring, or NULL if the file cannot be read or lists no backend.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static HashRing *load_ring(const char *path) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        return NULL;
+    }
+    HashRing *ring = calloc(1, sizeof *ring);
+    Backend *backends = calloc(MAX_BACKENDS, sizeof *backends);
+    if (!ring || !backends) {
+        free(ring);
+        free(backends);
+        fclose(in);
+        return NULL;
+    }
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t n;
+    unsigned count = 0;
+    while ((n = getline(&line, &cap, in)) >= 0 && count < MAX_BACKENDS) {
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r' || line[n - 1] == ' ')) {
+            line[--n] = '\0';
+        }
+        if (n == 0 || line[0] == '#') {
+            continue;
+        }
+        char *colon = strrchr(line, ':');
+        const char *host = "localhost";
+        const char *port = line;
+        if (colon) {
+            *colon = '\0';
+            host = line;
+            port = colon + 1;
+        }
+        if (!*host || !*port || strlen(host) >= MAX_HOST || strlen(port) >= MAX_PORT) {
+            fprintf(stderr, "ratsrouter: ignoring backend \"%s\"\n", line);
+            continue;
+        }
+        snprintf(backends[count].host, MAX_HOST, "%s", host);
+        snprintf(backends[count].port, MAX_PORT, "%s", port);
+        count++;
+    }
+    free(line);
+    fclose(in);
+    ring->points = count ? calloc((size_t)count * RING_VNODES, sizeof *ring->points) : NULL;
+    if (!ring->points) {
+        free(backends);
+        free(ring);
+        return NULL;
+    }
+    ring->backends = backends;
+    ring->backendCount = count;
+    for (unsigned b = 0; b < count; ++b) {
+        for (unsigned v = 0; v < RING_VNODES; ++v) {
+            char key[RING_KEY_SIZE];
+            int len = snprintf(key, sizeof key, "%s:%s#%u", backends[b].host,
+                               backends[b].port, v);
+            RingPoint *p = &ring->points[ring->pointCount++];
+            p->point = hash_key(key, (size_t)len);
+            p->backend = b;
+        }
+    }
+    qsort(ring->points, ring->pointCount, sizeof *ring->points, compare_points);
+    return ring;
+}
+
+/**
+ * free_ring
+ * ---------
+ * Releases a ring built by load_ring() (NULL is ignored).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void free_ring(HashRing *ring) {
+    if (!ring) {
+        return;
+    }
+    free(ring->backends);
+    free(ring->points);
+    free(ring);
+}
+
+/**
+ * route_candidates
+ * ----------------
+ * Finds the backends for a game name in ring order: the owner of the
+ * first point at or after the name's hash, then each next distinct
+ * backend clockwise. Trying them in this order means a game whose
+ * backend is down lands where the ring would put it were that backend
+ * removed.
+ *
+ * Parameters:
+ *   ctx      - router state.
+ *   gameName - game name bytes (not NUL-terminated).
+ *   len      - length of gameName.
+ *   out      - receives up to MAX_BACKENDS backends, best first.
+ *
+ * Returns:
+ *   Number of backends written to out (0 if the ring is empty).
+ *
+ * Concurrency:
+ *   Copies out under ringMutex, so a reload may free the ring as soon as
+ *   this returns.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static unsigned route_candidates(RouterCtx *ctx, const char *gameName, size_t len,
+                                 Backend *out) {
+    uint64_t h = hash_key(gameName, len);
+    pthread_mutex_lock(&ctx->ringMutex);
+    HashRing *ring = ctx->ring;
+    unsigned found = 0;
+    if (ring && ring->pointCount > 0) {
+        unsigned lo = 0;
+        unsigned hi = ring->pointCount;
+        while (lo < hi) {
+            unsigned mid = lo + (hi - lo) / 2;
+            if (ring->points[mid].point < h) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        bool taken[MAX_BACKENDS] = { false };
+        for (unsigned i = 0; i < ring->pointCount && found < ring->backendCount; ++i) {
+            unsigned b = ring->points[(lo + i) % ring->pointCount].backend;
+            if (!taken[b]) {
+                taken[b] = true;
+                out[found++] = ring->backends[b];
+            }
+        }
+    }
+    pthread_mutex_unlock(&ctx->ringMutex);
+    return found;
+}
+
+/**
+ * connect_backend
+ * ---------------
+ * Opens a TCP connection to one backend, with Nagle off (game traffic is
+ * small lines that must not be held back).
+ *
+ * Parameters:
+ *   backend - backend to connect to.
+ *
+ * Returns:
+ *   Connected socket, or -1.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int connect_backend(const Backend *backend) {
+    struct addrinfo hints, *res = NULL, *rp = NULL;
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(backend->host, backend->port, &hints, &res) != 0) {
+        return -1;
+    }
+    int fd = -1;
+    for (rp = res; rp; rp = rp->ai_next) {
+        fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, rp->ai_addr, rp->ai_addrlen) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+/**
+ * read_join_lines
+ * ---------------
+ * Reads from a new client until both join lines (player name, game name)
+ * have arrived. Anything the client sent after them is kept too: the
+ * whole buffer is replayed to the backend, so no byte is lost or
+ * reordered.
+ *
+ * Parameters:
+ *   fd         - client socket.
+ *   buf        - MAX_JOIN_BYTES buffer.
+ *   lenOut     - bytes read into buf.
+ *   gameOut    - start of the game name within buf.
+ *   gameLenOut - its length, without the line ending.
+ *
+ * Returns:
+ *   true once both lines are in; false on EOF, error, or if they do not
+ *   fit in MAX_JOIN_BYTES.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool read_join_lines(int fd, char *buf, size_t *lenOut, const char **gameOut,
+                            size_t *gameLenOut) {
+    size_t len = 0;
+    size_t scanned = 0;
+    size_t lineStart[JOIN_LINES + 1] = { 0 };
+    unsigned lines = 0;
+    while (lines < JOIN_LINES) {
+        if (len == MAX_JOIN_BYTES) {
+            return false;
+        }
+        ssize_t n = recv(fd, buf + len, MAX_JOIN_BYTES - len, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        len += (size_t)n;
+        for (; scanned < len && lines < JOIN_LINES; ++scanned) {
+            if (buf[scanned] == '\n') {
+                lineStart[++lines] = scanned + 1;
+            }
+        }
+    }
+    size_t gameLen = lineStart[JOIN_LINES] - 1 - lineStart[1];
+    // Same line endings as ratsserver's read_line_alloc() strips
+    while (gameLen > 0 && buf[lineStart[1] + gameLen - 1] == '\r') {
+        gameLen--;
+    }
+    *lenOut = len;
+    *gameOut = buf + lineStart[1];
+    *gameLenOut = gameLen;
+    return true;
+}
+
+/**
+ * send_all
+ * --------
+ * Writes a whole buffer to a socket, retrying short writes.
+ *
+ * Returns:
+ *   true if everything was sent.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+/**
+ * relay
+ * -----
+ * Moves bytes both ways between client and backend until both sides are
+ * done, without copying them through user space: each direction has a
+ * pipe, and splice() moves data socket -> pipe -> socket inside the
+ * kernel. End of input on one side is passed on as a half-close
+ * (shutdown SHUT_WR) so the other side sees the same EOF it would see
+ * without the router.
+ *
+ * Parameters:
+ *   clientFd  - client socket.
+ *   backendFd - backend socket.
+ *
+ * Returns:
+ *   None. Neither socket is closed here.
+ *
+ * Notes:
+ *   The write half of each splice may block if the receiver is slow;
+ *   game traffic is a few short lines per trick, so this never stalls
+ *   the other direction for long.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void relay(int clientFd, int backendFd) {
+    int fds[2] = { clientFd, backendFd };
+    int pipes[2][2];                // pipes[d] carries fds[d] -> fds[1 - d]
+    if (pipe(pipes[0]) != 0) {
+        return;
+    }
+    if (pipe(pipes[1]) != 0) {
+        close(pipes[0][0]);
+        close(pipes[0][1]);
+        return;
+    }
+    bool open[2] = { true, true };
+    bool failed = false;
+    while ((open[0] || open[1]) && !failed) {
+        struct pollfd pfd[2];
+        for (int d = 0; d < 2; ++d) {
+            pfd[d].fd = open[d] ? fds[d] : -1;
+            pfd[d].events = POLLIN;
+            pfd[d].revents = 0;
+        }
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (int d = 0; d < 2 && !failed; ++d) {
+            if (!open[d] || !(pfd[d].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            ssize_t n = splice(fds[d], NULL, pipes[d][1], NULL, SPLICE_CHUNK,
+                               SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+                continue;
+            }
+            if (n <= 0) {
+                // EOF (or reset) from this side: pass the end of input on
+                open[d] = false;
+                shutdown(fds[1 - d], SHUT_WR);
+                continue;
+            }
+            while (n > 0) {
+                ssize_t m = splice(pipes[d][0], NULL, fds[1 - d], NULL, (size_t)n,
+                                   SPLICE_F_MOVE);
+                if (m < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (m <= 0) {
+                    failed = true;      // receiver gone; drop the connection
+                    break;
+                }
+                n -= m;
+            }
+        }
+    }
+    for (int d = 0; d < 2; ++d) {
+        close(pipes[d][0]);
+        close(pipes[d][1]);
+    }
+}
+
+/**
+ * connection_thread
+ * -----------------
+ * Serves one client: reads the join lines, connects to the game name's
+ * backend (or the next one on the ring if it is down), replays what was
+ * read, and relays until both sides hang up. The backend sends the
+ * greeting itself, so clients see exactly the ratsserver protocol.
+ *
+ * Parameters:
+ *   arg - ConnArg* (freed here).
+ *
+ * Returns:
+ *   NULL.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void *connection_thread(void *arg) {
+    ConnArg *conn = (ConnArg *)arg;
+    RouterCtx *ctx = conn->ctx;
+    int clientFd = conn->fd;
+    free(conn);
+
+    char buf[MAX_JOIN_BYTES];
+    size_t len = 0;
+    const char *gameName = NULL;
+    size_t gameLen = 0;
+    if (!read_join_lines(clientFd, buf, &len, &gameName, &gameLen)) {
+        close(clientFd);
+        return NULL;
+    }
+    Backend *candidates = malloc(MAX_BACKENDS * sizeof *candidates);
+    unsigned count = candidates ? route_candidates(ctx, gameName, gameLen, candidates) : 0;
+    int backendFd = -1;
+    for (unsigned i = 0; i < count && backendFd < 0; ++i) {
+        backendFd = connect_backend(&candidates[i]);
+    }
+    free(candidates);
+    if (backendFd < 0) {
+        atomic_fetch_add(&ctx->unroutable, 1ul);
+        close(clientFd);
+        return NULL;
+    }
+    atomic_fetch_add(&ctx->routed, 1ul);
+    if (send_all(backendFd, buf, len)) {
+        relay(clientFd, backendFd);
+    }
+    close(backendFd);
+    close(clientFd);
+    return NULL;
+}
+
+/**
+ * reload_thread
+ * -------------
+ * Waits for SIGHUP, then re-reads the backend file and swaps in the new
+ * ring. Games already relayed stay on their backend; new joins use the
+ * new ring. An unreadable or empty file leaves the old ring in place.
+ * Each SIGHUP also prints the routing counters to stderr.
+ *
+ * Parameters:
+ *   arg - RouterCtx*.
+ *
+ * Returns:
+ *   NULL (never returns in practice).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void *reload_thread(void *arg) {
+    RouterCtx *ctx = (RouterCtx *)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    for (;;) {
+        int sig;
+        if (sigwait(&set, &sig) != 0) {
+            continue;
+        }
+        HashRing *ring = load_ring(ctx->backendFile);
+        if (!ring) {
+            fprintf(stderr, "ratsrouter: cannot load backends from \"%s\", "
+                    "keeping the current list\n", ctx->backendFile);
+            continue;
+        }
+        pthread_mutex_lock(&ctx->ringMutex);
+        HashRing *old = ctx->ring;
+        ctx->ring = ring;
+        pthread_mutex_unlock(&ctx->ringMutex);
+        free_ring(old);
+        fprintf(stderr, "ratsrouter: %u backend(s); routed %lu, unroutable %lu\n",
+                ring->backendCount, atomic_load(&ctx->routed),
+                atomic_load(&ctx->unroutable));
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != ARGC || !*argv[ARG_PORT] || !*argv[ARG_BACKENDS]) {
+        die_usage();
+    }
+    RouterCtx ctx;
+    ctx.backendFile = argv[ARG_BACKENDS];
+    ctx.ring = load_ring(ctx.backendFile);
+    if (!ctx.ring) {
+        fprintf(stderr, "ratsrouter: cannot load backends from \"%s\"\n", ctx.backendFile);
+        exit(BACKENDS_EXIT);
+    }
+    pthread_mutex_init(&ctx.ringMutex, NULL);
+    atomic_init(&ctx.routed, 0ul);
+    atomic_init(&ctx.unroutable, 0ul);
+
+    // Every thread inherits this mask: SIGHUP goes to reload_thread only,
+    // and a write to a closed socket returns EPIPE instead of killing us
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    int listenFd = listen_and_report_port(argv[ARG_PORT]);
+    pthread_t tid;
+    if (pthread_create(&tid, NULL, reload_thread, &ctx) == 0) {
+        pthread_detach(tid);
+    }
+    for (;;) {
+        int clientFd = accept(listenFd, NULL, NULL);
+        if (clientFd < 0) {
+            continue;
+        }
+        int one = 1;
+        setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        ConnArg *conn = malloc(sizeof *conn);
+        if (!conn) {
+            close(clientFd);
+            continue;
+        }
+        conn->ctx = &ctx;
+        conn->fd = clientFd;
+        if (pthread_create(&tid, NULL, connection_thread, conn) != 0) {
+            close(clientFd);
+            free(conn);
+            continue;
+        }
+        pthread_detach(tid);
+    }
+}
@@ -0,0 +1,679 @@
+// shmring.c — shared-memory ring transport (see shmring.h)
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "shmring.h"
+
+#define SHMRING_SPIN 2000               // polls of an idle ring before sleeping
+#define SHMRING_WRITE_SLICE_MS 50       // a full ring is rechecked at least this often
+#define SHMRING_ATTACH_FDS 3            // memfd, server eventfd, client eventfd
+#define SHMRING_SEALS (F_SEAL_SHRINK | F_SEAL_GROW)  // the segment's size is fixed
+#define SHMRING_EVENTFD_LINK "anon_inode:[eventfd]"
+#define MS_PER_SEC 1000
+#define USEC_PER_MS 1000
+
+typedef enum {
+    RING_WAIT_READY,
+    RING_WAIT_TIMEOUT,
+    RING_WAIT_HANGUP,
+    RING_WAIT_ERROR
+} RingWait;
+
+typedef struct {
+    ShmRingEnd *end;
+    int hangupFd;
+    void (*onClose)(void *);
+    void *closeArg;
+} RingCookie;
+
+static void cpu_relax(void);
+static void ring_wake(int fd);
+static bool ring_ready(ShmRing *ring, bool forSpace);
+static int socket_timeout_ms(int fd);
+static RingWait ring_wait(ShmRingEnd *end, ShmRing *ring, bool forSpace, int hangupFd,
+                          int wakeFd, int timeoutMs);
+static ssize_t ring_put(ShmRing *ring, const char *buf, size_t len);
+static ssize_t ring_get(ShmRing *ring, char *buf, size_t len);
+static bool is_eventfd(int fd);
+static ShmRingEnd *end_create(ShmRingSegment *seg, bool serverSide, int waitFd, int peerFd,
+                              int linkFd);
+static ssize_t cookie_read(void *cookie, char *buf, size_t size);
+static ssize_t cookie_write(void *cookie, const char *buf, size_t size);
+static int cookie_close(void *cookie);
+
+/**
+ * cpu_relax
+ * ---------
+ * Spin-loop hint: lets a sibling hyper-thread run while we poll a ring.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/**
+ * ring_wake
+ * ---------
+ * Wakes whoever sleeps on eventfd `fd`.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static void ring_wake(int fd) {
+    uint64_t one = 1;
+    (void)!write(fd, &one, sizeof one);
+}
+
+/**
+ * shmring_readable / shmring_writable
+ * -----------------------------------
+ * Bytes waiting in a ring, and room left in it. Both sides of the segment
+ * can scribble on it, so a ring whose positions make no sense reads as
+ * neither readable nor writable (ring_get/ring_put report it).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+size_t shmring_readable(ShmRing *ring) {
+    unsigned used = atomic_load(&ring->tail) - atomic_load(&ring->head);
+    return used <= SHMRING_CAPACITY ? used : 0;
+}
+
+size_t shmring_writable(ShmRing *ring) {
+    unsigned used = atomic_load(&ring->tail) - atomic_load(&ring->head);
+    return used <= SHMRING_CAPACITY ? SHMRING_CAPACITY - used : 0;
+}
+
+/**
+ * ring_ready
+ * ----------
+ * Whether a waiter may go on: a reader needs bytes (or the producer to
+ * have closed the ring), a writer needs room.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool ring_ready(ShmRing *ring, bool forSpace) {
+    if (forSpace) {
+        return shmring_writable(ring) > 0;
+    }
+    return shmring_readable(ring) > 0 || atomic_load(&ring->closed);
+}
+
+/**
+ * socket_timeout_ms
+ * -----------------
+ * SO_RCVTIMEO of a socket in milliseconds, or -1 if none is set. Lets a
+ * ring stream honour the same receive timeout as the socket it stands in
+ * for (ratsserver --turn-timeout).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static int socket_timeout_ms(int fd) {
+    struct timeval tv;
+    socklen_t len = sizeof tv;
+    if (fd < 0 || getsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, &len) != 0 ||
+            (tv.tv_sec == 0 && tv.tv_usec == 0)) {
+        return -1;
+    }
+    return (int)(tv.tv_sec * MS_PER_SEC + tv.tv_usec / USEC_PER_MS);
+}
+
+/**
+ * ring_wait
+ * ---------
+ * Waits until `ring` is ready for this side. Spins for a while first
+ * (end->spin polls), as the peer usually answers within microseconds;
+ * only then does it raise its waiting flag and sleep on the eventfd.
+ *
+ * Parameters:
+ *   end       - this side of the segment.
+ *   ring      - ring being waited on (end->rx for reads, end->tx for writes).
+ *   forSpace  - wait for room rather than for data.
+ *   hangupFd  - socket whose hang-up ends the wait, or -1.
+ *   wakeFd    - descriptor whose readability ends the wait, or -1. It is
+ *               not read; its owner drains it.
+ *   timeoutMs - longest sleep, -1 for none, 0 to only check, or
+ *               SHMRING_SOCKET_TIMEOUT to use hangupFd's SO_RCVTIMEO.
+ *
+ * Returns:
+ *   RING_WAIT_READY, RING_WAIT_TIMEOUT, RING_WAIT_HANGUP, or
+ *   RING_WAIT_ERROR with errno set (EINTR when a signal arrived or
+ *   wakeFd became readable).
+ *
+ * Notes:
+ *   The flag is raised before the final check and the producer publishes
+ *   its data before reading the flag, both sequentially consistent, so at
+ *   least one of them sees the other: a wake-up cannot be lost.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static RingWait ring_wait(ShmRingEnd *end, ShmRing *ring, bool forSpace, int hangupFd,
+                          int wakeFd, int timeoutMs) {
+    if (timeoutMs == 0) {
+        return ring_ready(ring, forSpace) ? RING_WAIT_READY : RING_WAIT_TIMEOUT;
+    }
+    for (int spin = 0; spin < end->spin; ++spin) {
+        if (ring_ready(ring, forSpace)) {
+            return RING_WAIT_READY;
+        }
+        cpu_relax();
+    }
+    if (timeoutMs == SHMRING_SOCKET_TIMEOUT) {
+        timeoutMs = socket_timeout_ms(hangupFd);
+    }
+    atomic_uint *flag = forSpace ? &ring->writerWaiting : &ring->readerWaiting;
+    atomic_store(flag, 1u);
+    if (ring_ready(ring, forSpace)) {
+        atomic_store(flag, 0u);
+        return RING_WAIT_READY;
+    }
+    // poll() skips the entries whose descriptor is -1
+    struct pollfd pfd[3] = {
+        { .fd = end->waitFd, .events = POLLIN, .revents = 0 },
+        { .fd = hangupFd, .events = POLLIN | POLLRDHUP, .revents = 0 },
+        { .fd = wakeFd, .events = POLLIN, .revents = 0 },
+    };
+    int ready = poll(pfd, 3, timeoutMs);
+    atomic_store(flag, 0u);
+    if (ready < 0) {
+        return RING_WAIT_ERROR;
+    }
+    if (pfd[0].revents & POLLIN) {
+        uint64_t count;
+        (void)!read(end->waitFd, &count, sizeof count);
+    }
+    if (ring_ready(ring, forSpace)) {
+        return RING_WAIT_READY;
+    }
+    if (ready == 0) {
+        return RING_WAIT_TIMEOUT;
+    }
+    if (hangupFd >= 0 && pfd[1].revents) {
+        return RING_WAIT_HANGUP;
+    }
+    if (wakeFd >= 0 && pfd[2].revents) {
+        errno = EINTR;
+        return RING_WAIT_ERROR;
+    }
+    return RING_WAIT_READY;     // woken for the other direction; caller rechecks
+}
+
+/**
+ * ring_put / ring_get
+ * -------------------
+ * Copy bytes into or out of a ring and publish the new position. The copy
+ * wraps at most once. Neither blocks.
+ *
+ * Returns:
+ *   Bytes moved (0 if the ring is full / empty), or -1 with errno EPROTO
+ *   if the positions in the segment are corrupt.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static ssize_t ring_put(ShmRing *ring, const char *buf, size_t len) {
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head > SHMRING_CAPACITY) {
+        errno = EPROTO;
+        return -1;
+    }
+    size_t room = SHMRING_CAPACITY - (tail - head);
+    size_t n = len < room ? len : room;
+    size_t at = tail & (SHMRING_CAPACITY - 1);
+    size_t first = n < SHMRING_CAPACITY - at ? n : SHMRING_CAPACITY - at;
+    memcpy(ring->data + at, buf, first);
+    memcpy(ring->data, buf + first, n - first);
+    atomic_store(&ring->tail, tail + (unsigned)n);
+    return (ssize_t)n;
+}
+
+static ssize_t ring_get(ShmRing *ring, char *buf, size_t len) {
+    unsigned head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (tail - head > SHMRING_CAPACITY) {
+        errno = EPROTO;
+        return -1;
+    }
+    size_t avail = tail - head;
+    size_t n = len < avail ? len : avail;
+    size_t at = head & (SHMRING_CAPACITY - 1);
+    size_t first = n < SHMRING_CAPACITY - at ? n : SHMRING_CAPACITY - at;
+    memcpy(buf, ring->data + at, first);
+    memcpy(buf + first, ring->data, n - first);
+    atomic_store(&ring->head, head + (unsigned)n);
+    return (ssize_t)n;
+}
+
+/**
+ * shmring_send
+ * ------------
+ * Writes `len` bytes to this side's outgoing ring and wakes the peer if it
+ * is asleep waiting for them.
+ *
+ * Parameters:
+ *   end      - this side of the segment.
+ *   buf, len - bytes to send.
+ *   hangupFd - socket whose hang-up means the peer is gone, or -1.
+ *   wait     - wait for room; if false, either everything fits now or
+ *              nothing is written and errno is EAGAIN.
+ *
+ * Returns:
+ *   len on success; -1 with errno EPIPE (peer gone), EAGAIN, EINTR or
+ *   EPROTO. Bytes already written stay written.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+ssize_t shmring_send(ShmRingEnd *end, const char *buf, size_t len, int hangupFd,
+                     bool wait) {
+    ShmRing *ring = end->tx;
+    pthread_mutex_lock(&end->txLock);
+    if (!wait && shmring_writable(ring) < len) {
+        pthread_mutex_unlock(&end->txLock);
+        errno = EAGAIN;
+        return -1;
+    }
+    size_t sent = 0;
+    while (sent < len) {
+        ssize_t n = ring_put(ring, buf + sent, len - sent);
+        if (n < 0) {
+            break;
+        }
+        if (n > 0) {
+            sent += (size_t)n;
+            if (atomic_load(&ring->readerWaiting)) {
+                ring_wake(end->peerFd);
+            }
+            continue;
+        }
+        RingWait waited = ring_wait(end, ring, true, hangupFd, -1, SHMRING_WRITE_SLICE_MS);
+        if (waited == RING_WAIT_HANGUP) {
+            errno = EPIPE;
+            break;
+        }
+        if (waited == RING_WAIT_ERROR) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&end->txLock);
+    return sent == len ? (ssize_t)len : -1;
+}
+
+/**
+ * shmring_recv
+ * ------------
+ * Reads up to `len` bytes from this side's incoming ring, waiting if it is
+ * empty, and wakes the peer if it was waiting for room.
+ *
+ * Parameters:
+ *   end       - this side of the segment.
+ *   buf, len  - destination.
+ *   hangupFd  - socket whose hang-up means the peer is gone, or -1.
+ *   timeoutMs - longest wait: -1 for none, 0 to not wait, or
+ *               SHMRING_SOCKET_TIMEOUT.
+ *   wakeFd    - descriptor (an eventfd, say) whose readability ends a
+ *               wait with EINTR, or -1. It is never read here.
+ *
+ * Returns:
+ *   Bytes read; 0 once the peer has closed the ring or hung up and
+ *   nothing is left; -1 with errno EAGAIN (timed out), EINTR or EPROTO.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+ssize_t shmring_recv(ShmRingEnd *end, char *buf, size_t len, int hangupFd,
+                     int timeoutMs, int wakeFd) {
+    ShmRing *ring = end->rx;
+    pthread_mutex_lock(&end->rxLock);
+    ssize_t result = -1;
+    for (;;) {
+        ssize_t n = ring_get(ring, buf, len);
+        if (n != 0) {
+            if (n > 0 && atomic_load(&ring->writerWaiting)) {
+                ring_wake(end->peerFd);
+            }
+            result = n;
+            break;
+        }
+        if (atomic_load(&ring->closed) && shmring_readable(ring) == 0) {
+            result = 0;
+            break;
+        }
+        RingWait waited = ring_wait(end, ring, false, hangupFd, wakeFd, timeoutMs);
+        if (waited == RING_WAIT_TIMEOUT) {
+            errno = EAGAIN;
+            break;
+        }
+        if (waited == RING_WAIT_HANGUP) {
+            result = 0;
+            break;
+        }
+        if (waited == RING_WAIT_ERROR) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&end->rxLock);
+    return result;
+}
+
+/**
+ * shmring_mark_closed
+ * -------------------
+ * Tells the peer this side will send nothing more; its reads return 0
+ * once the ring is drained.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+void shmring_mark_closed(ShmRingEnd *end) {
+    atomic_store(&end->tx->closed, 1u);
+    ring_wake(end->peerFd);
+}
+
+/**
+ * end_create
+ * ----------
+ * Wraps a mapped segment as one side's ShmRingEnd.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static ShmRingEnd *end_create(ShmRingSegment *seg, bool serverSide, int waitFd, int peerFd,
+                              int linkFd) {
+    ShmRingEnd *end = calloc(1, sizeof *end);
+    if (!end) {
+        return NULL;
+    }
+    end->seg = seg;
+    end->rx = serverSide ? &seg->toServer : &seg->toClient;
+    end->tx = serverSide ? &seg->toClient : &seg->toServer;
+    end->waitFd = waitFd;
+    end->peerFd = peerFd;
+    end->linkFd = linkFd;
+    // Spinning on one CPU only delays the peer we are waiting for
+    end->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHMRING_SPIN : 0;
+    pthread_mutex_init(&end->rxLock, NULL);
+    pthread_mutex_init(&end->txLock, NULL);
+    return end;
+}
+
+/**
+ * shmring_connect
+ * ---------------
+ * Bot side: builds a fresh segment and attaches it to the server listening
+ * on the AF_UNIX socket `path` (ratsserver --ring-path). The server treats
+ * the result like a newly accepted TCP client.
+ *
+ * Parameters:
+ *   path - the server's ring socket.
+ *
+ * Returns:
+ *   The bot's end (free with shmring_close()), or NULL on failure.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+ShmRingEnd *shmring_connect(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof addr.sun_path) {
+        return NULL;
+    }
+    strcpy(addr.sun_path, path);
+
+    int memFd = memfd_create("ratsring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memFd < 0) {
+        return NULL;
+    }
+    ShmRingSegment *seg = MAP_FAILED;
+    // Sealed, the server can map the segment without risking SIGBUS
+    if (ftruncate(memFd, sizeof *seg) == 0 && fcntl(memFd, F_ADD_SEALS, SHMRING_SEALS) == 0) {
+        seg = mmap(NULL, sizeof *seg, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    }
+    int serverEv = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int clientEv = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool ok = seg != MAP_FAILED && serverEv >= 0 && clientEv >= 0 && sock >= 0 &&
+            connect(sock, (struct sockaddr *)&addr, sizeof addr) == 0;
+    if (ok) {
+        // A fresh memfd is zero-filled: every position and flag starts at 0
+        seg->magic = SHMRING_MAGIC;
+        seg->version = SHMRING_VERSION;
+        seg->capacity = SHMRING_CAPACITY;
+
+        int fds[SHMRING_ATTACH_FDS] = { memFd, serverEv, clientEv };
+        char tag = 'R';
+        struct iovec iov = { .iov_base = &tag, .iov_len = 1 };
+        union {
+            struct cmsghdr align;
+            char buf[CMSG_SPACE(sizeof fds)];
+        } control;
+        memset(&control, 0, sizeof control);
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                              .msg_control = control.buf,
+                              .msg_controllen = sizeof control.buf };
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof fds);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof fds);
+        ok = sendmsg(sock, &msg, MSG_NOSIGNAL) == 1;
+    }
+    close(memFd);
+    ShmRingEnd *end = ok ? end_create(seg, false, clientEv, serverEv, sock) : NULL;
+    if (!end) {
+        if (seg != MAP_FAILED) munmap(seg, sizeof *seg);
+        if (serverEv >= 0) close(serverEv);
+        if (clientEv >= 0) close(clientEv);
+        if (sock >= 0) close(sock);
+    }
+    return end;
+}
+
+/**
+ * is_eventfd
+ * ----------
+ * Tells whether a descriptor received from a bot is an eventfd, going by
+ * the name the kernel gives its anonymous inode.
+ *
+ * Parameters:
+ *   fd - descriptor to check (may be -1).
+ *
+ * Returns:
+ *   true if fd is an eventfd.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static bool is_eventfd(int fd) {
+    char path[64];
+    char target[sizeof SHMRING_EVENTFD_LINK];
+    if (fd < 0) {
+        return false;
+    }
+    snprintf(path, sizeof path, "/proc/self/fd/%d", fd);
+    ssize_t n = readlink(path, target, sizeof target);
+    return n == (ssize_t)sizeof target - 1 &&
+            memcmp(target, SHMRING_EVENTFD_LINK, (size_t)n) == 0;
+}
+
+/**
+ * shmring_attach
+ * --------------
+ * Server side: receives the segment and eventfds a bot sent with
+ * shmring_connect() and maps the segment. The segment must be a memfd
+ * sealed against shrinking and growing, so the bot cannot truncate it
+ * under the server's mapping, and both other descriptors must be
+ * eventfds. Blocks until the bot's message arrives or linkFd's
+ * SO_RCVTIMEO expires.
+ *
+ * Parameters:
+ *   linkFd - accepted connection on the ring socket; the returned end
+ *            owns it. On failure the caller still closes it.
+ *
+ * Returns:
+ *   The server's end, or NULL if the bot sent anything unexpected.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+ShmRingEnd *shmring_attach(int linkFd) {
+    int fds[SHMRING_ATTACH_FDS];
+    char tag = 0;
+    struct iovec iov = { .iov_base = &tag, .iov_len = 1 };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof fds)];
+    } control;
+    struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1,
+                          .msg_control = control.buf,
+                          .msg_controllen = sizeof control.buf };
+    if (recvmsg(linkFd, &msg, MSG_CMSG_CLOEXEC) != 1) {
+        return NULL;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        return NULL;
+    }
+    size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    int received[SHMRING_ATTACH_FDS] = { -1, -1, -1 };
+    memcpy(received, CMSG_DATA(cmsg),
+           (count < SHMRING_ATTACH_FDS ? count : SHMRING_ATTACH_FDS) * sizeof(int));
+    ShmRingSegment *seg = MAP_FAILED;
+    struct stat st;
+    if (count == SHMRING_ATTACH_FDS && tag == 'R' && !(msg.msg_flags & MSG_CTRUNC) &&
+            fstat(received[0], &st) == 0 && S_ISREG(st.st_mode) &&
+            st.st_size >= (off_t)sizeof *seg &&
+            (fcntl(received[0], F_GET_SEALS) & SHMRING_SEALS) == SHMRING_SEALS &&
+            is_eventfd(received[1]) && is_eventfd(received[2])) {
+        seg = mmap(NULL, sizeof *seg, PROT_READ | PROT_WRITE, MAP_SHARED, received[0], 0);
+    }
+    close(received[0]);
+    ShmRingEnd *end = NULL;
+    if (seg != MAP_FAILED && seg->magic == SHMRING_MAGIC &&
+            seg->version == SHMRING_VERSION && seg->capacity == SHMRING_CAPACITY) {
+        end = end_create(seg, true, received[1], received[2], linkFd);
+    }
+    if (!end) {
+        if (seg != MAP_FAILED) munmap(seg, sizeof *seg);
+        for (size_t i = 1; i < count && i < SHMRING_ATTACH_FDS; ++i) {
+            close(received[i]);
+        }
+    }
+    return end;
+}
+
+/**
+ * shmring_release
+ * ---------------
+ * Unmaps the segment and closes the end's descriptors (including linkFd
+ * unless it was already closed and set to -1).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+void shmring_release(ShmRingEnd *end) {
+    if (!end) {
+        return;
+    }
+    munmap(end->seg, sizeof *end->seg);
+    close(end->waitFd);
+    close(end->peerFd);
+    if (end->linkFd >= 0) {
+        close(end->linkFd);
+    }
+    pthread_mutex_destroy(&end->rxLock);
+    pthread_mutex_destroy(&end->txLock);
+    free(end);
+}
+
+/**
+ * shmring_close
+ * -------------
+ * Bot side hang-up: closes the outgoing ring and releases the end. The
+ * server sees the attach socket close, just as it would a TCP client.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+void shmring_close(ShmRingEnd *end) {
+    if (end) {
+        shmring_mark_closed(end);
+        shmring_release(end);
+    }
+}
+
+/**
+ * cookie_read / cookie_write / cookie_close
+ * -----------------------------------------
+ * fopencookie() hooks for shmring_fopen(). Reads honour the hang-up
+ * socket's SO_RCVTIMEO; writes wait for room.
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+static ssize_t cookie_read(void *cookie, char *buf, size_t size) {
+    RingCookie *rc = cookie;
+    return shmring_recv(rc->end, buf, size, rc->hangupFd, SHMRING_SOCKET_TIMEOUT, -1);
+}
+
+static ssize_t cookie_write(void *cookie, const char *buf, size_t size) {
+    RingCookie *rc = cookie;
+    return shmring_send(rc->end, buf, size, rc->hangupFd, true) < 0 ? -1 : (ssize_t)size;
+}
+
+static int cookie_close(void *cookie) {
+    RingCookie *rc = cookie;
+    if (rc->onClose) {
+        rc->onClose(rc->closeArg);
+    }
+    free(rc);
+    return 0;
+}
+
+/**
+ * shmring_fopen
+ * -------------
+ * Opens a stdio stream over one direction of a ring ("r": incoming,
+ * "w": outgoing), so code written against fdopen()'d sockets can use a
+ * ring unchanged.
+ *
+ * Parameters:
+ *   end      - this side of the segment; must outlive the stream.
+ *   hangupFd - socket that signals the peer has gone (and carries any
+ *              receive timeout), or -1.
+ *   mode     - "r" or "w".
+ *   onClose  - called with closeArg by fclose(), or NULL.
+ *
+ * Returns:
+ *   The stream, or NULL on allocation failure (onClose is not called).
+ *
+ * REF: Comments created by AI, reviewed and modified for assignment compliance.
+ */
+FILE *shmring_fopen(ShmRingEnd *end, int hangupFd, const char *mode,
+                    void (*onClose)(void *), void *closeArg) {
+    RingCookie *rc = malloc(sizeof *rc);
+    if (!rc) {
+        return NULL;
+    }
+    rc->end = end;
+    rc->hangupFd = hangupFd;
+    rc->onClose = onClose;
+    rc->closeArg = closeArg;
+    cookie_io_functions_t io = {
+        .read = mode[0] == 'r' ? cookie_read : NULL,
+        .write = mode[0] == 'w' ? cookie_write : NULL,
+        .seek = NULL,
+        .close = cookie_close,
+    };
+    FILE *stream = fopencookie(rc, mode, io);
+    if (!stream) {
+        free(rc);
+    }
+    return stream;
+}
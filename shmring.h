@@ -0,0 +1,76 @@
+// shmring.h — shared-memory ring transport between ratsserver and
+// co-located bot processes (ratsserver --ring-path, ratsbench ring:PATH).
+//
+// A bot creates one segment per connection: two single-producer,
+// single-consumer byte rings (bot -> server, server -> bot) in a memfd.
+// It passes the memfd and two eventfds to the server over an AF_UNIX
+// socket; that socket then only signals hang-up. Protocol lines are the
+// same bytes the TCP path carries. A side that finds its ring empty spins
+// briefly (on multi-core hosts), then sleeps on its eventfd; the other side only writes the
+// eventfd when the sleeper has said it is waiting, so a busy exchange
+// makes no system calls at all.
+
+#ifndef SHMRING_H
+#define SHMRING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define SHMRING_MAGIC 0x52415452u       // "RATR"
+#define SHMRING_VERSION 1u
+#define SHMRING_CAPACITY 8192u          // bytes per direction (power of two)
+#define SHMRING_CACHE_LINE 64
+#define SHMRING_SOCKET_TIMEOUT (-2)    // shmring_recv: use the socket's SO_RCVTIMEO
+
+// One direction. head is only written by the consumer and tail only by
+// the producer; each lives on its own cache line.
+typedef struct {
+    atomic_uint head __attribute__((aligned(SHMRING_CACHE_LINE)));
+    atomic_uint writerWaiting;          // producer found the ring full
+    atomic_uint tail __attribute__((aligned(SHMRING_CACHE_LINE)));
+    atomic_uint readerWaiting;          // consumer found the ring empty
+    atomic_uint closed;                 // producer will write no more
+    char data[SHMRING_CAPACITY] __attribute__((aligned(SHMRING_CACHE_LINE)));
+} ShmRing;
+
+typedef struct {
+    unsigned magic;
+    unsigned version;
+    unsigned capacity;
+    ShmRing toServer;
+    ShmRing toClient;
+} ShmRingSegment;
+
+// One side's view of a segment. The locks keep each ring single-producer
+// and single-consumer when several threads of a process share the end.
+typedef struct {
+    ShmRingSegment *seg;
+    ShmRing *rx;                        // ring this side reads
+    ShmRing *tx;                        // ring this side writes
+    int waitFd;                         // eventfd this side sleeps on
+    int peerFd;                         // eventfd that wakes the other side
+    int linkFd;                         // the AF_UNIX attach socket
+    int spin;                           // polls before sleeping (0 on one CPU)
+    pthread_mutex_t rxLock;
+    pthread_mutex_t txLock;
+} ShmRingEnd;
+
+ShmRingEnd *shmring_connect(const char *path);
+ShmRingEnd *shmring_attach(int linkFd);
+void shmring_close(ShmRingEnd *end);
+void shmring_release(ShmRingEnd *end);
+ssize_t shmring_send(ShmRingEnd *end, const char *buf, size_t len, int hangupFd,
+                     bool wait);
+ssize_t shmring_recv(ShmRingEnd *end, char *buf, size_t len, int hangupFd,
+                     int timeoutMs, int wakeFd);
+size_t shmring_readable(ShmRing *ring);
+size_t shmring_writable(ShmRing *ring);
+void shmring_mark_closed(ShmRingEnd *end);
+FILE *shmring_fopen(ShmRingEnd *end, int hangupFd, const char *mode,
+                    void (*onClose)(void *), void *closeArg);
+
+#endif